@@ -0,0 +1,41 @@
+#!/bin/sh
+# Build every firmware profile (see src/build_profile.h) and print its flash
+# and RAM use. Needs arduino-cli with the board core and libraries installed.
+# Fails if a profile leaves less than STACK_RESERVE bytes of RAM free for the
+# stack and the display's frame buffer, which are allocated at run time.
+#
+#   scripts/size-report.sh              # Arduino Leonardo
+#   FQBN=arduino:avr:micro scripts/size-report.sh
+set -e
+
+FQBN=${FQBN:-arduino:avr:leonardo}
+STACK_RESERVE=${STACK_RESERVE:-768}
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# arduino-cli wants the folder named after the .ino
+mkdir "$WORK/steppper"
+cp "$ROOT/steppper.ino" "$WORK/steppper/"
+cp -R "$ROOT/src" "$WORK/steppper/"
+
+status=0
+printf '%-12s %8s %8s %8s\n' PROFILE FLASH RAM FREE
+for profile in FULL HEADLESS USB_ONLY STANDALONE; do
+  out=$(arduino-cli compile --fqbn "$FQBN" \
+    --build-property "compiler.cpp.extra_flags=-DMOTORILLO_PROFILE=PROFILE_$profile" \
+    "$WORK/steppper" 2>&1) || {
+    echo "$out"
+    echo "$profile: build failed" >&2
+    exit 1
+  }
+  flash=$(echo "$out" | sed -n 's/^Sketch uses \([0-9]*\) bytes.*/\1/p')
+  ram=$(echo "$out" | sed -n 's/^Global variables use \([0-9]*\) bytes.*/\1/p')
+  free=$(echo "$out" | sed -n 's/.* leaving \([0-9]*\) bytes for local.*/\1/p')
+  printf '%-12s %8s %8s %8s\n' "$profile" "$flash" "$ram" "$free"
+  if [ "${free:-0}" -lt "$STACK_RESERVE" ]; then
+    echo "$profile: only ${free:-0} bytes of RAM left (want $STACK_RESERVE)" >&2
+    status=1
+  fi
+done
+exit $status
@@ -0,0 +1,90 @@
+#ifndef BUILD_PROFILE_H
+#define BUILD_PROFILE_H
+
+// Build profiles. Pick one by passing -DMOTORILLO_PROFILE=PROFILE_... to the
+// compiler (see scripts/size-report.sh) or by changing the default below.
+// Individual FEATURE_* flags can also be overridden the same way.
+//
+//   Profile     Display  Boot anim  Menu/button  WebUSB  Text protocol
+//   FULL        yes      yes        yes          yes     yes
+//   HEADLESS    -        -          yes          yes     yes
+//   USB_ONLY    -        -          -            yes     -
+//   STANDALONE  yes      yes        yes          -       -
+//
+// FEATURE_TMC2209 follows the driver wiring rather than the profile.
+#define PROFILE_FULL 0
+#define PROFILE_HEADLESS 1   // No OLED; button and WebUSB
+#define PROFILE_USB_ONLY 2   // Driven entirely over the binary protocol
+#define PROFILE_STANDALONE 3 // OLED and button, no host connection
+
+#ifndef MOTORILLO_PROFILE
+#define MOTORILLO_PROFILE PROFILE_FULL
+#endif
+
+#if MOTORILLO_PROFILE == PROFILE_HEADLESS
+#define PROFILE_DISPLAY 0
+#define PROFILE_MENU 1
+#define PROFILE_USB 1
+#define PROFILE_TEXT 1
+#elif MOTORILLO_PROFILE == PROFILE_USB_ONLY
+#define PROFILE_DISPLAY 0
+#define PROFILE_MENU 0
+#define PROFILE_USB 1
+#define PROFILE_TEXT 0
+#elif MOTORILLO_PROFILE == PROFILE_STANDALONE
+#define PROFILE_DISPLAY 1
+#define PROFILE_MENU 1
+#define PROFILE_USB 0
+#define PROFILE_TEXT 0
+#else
+#define PROFILE_DISPLAY 1
+#define PROFILE_MENU 1
+#define PROFILE_USB 1
+#define PROFILE_TEXT 1
+#endif
+
+// SSD1306 OLED (frame buffer, fonts, Adafruit GFX)
+#ifndef FEATURE_DISPLAY
+#define FEATURE_DISPLAY PROFILE_DISPLAY
+#endif
+
+// Sliding-camera animation at power-up
+#ifndef FEATURE_BOOT_ANIMATION
+#define FEATURE_BOOT_ANIMATION FEATURE_DISPLAY
+#endif
+
+// Button, program menu and pause menu
+#ifndef FEATURE_MENU
+#define FEATURE_MENU PROFILE_MENU
+#endif
+
+// WebUSB interface and the binary command protocol
+#ifndef FEATURE_USB
+#define FEATURE_USB PROFILE_USB
+#endif
+
+// Text output: the program listing sent on connect and status/error lines.
+// Without it the host keeps its own library and uses CMD_PROGRAM_SYNC.
+#ifndef FEATURE_TEXT_PROTOCOL
+#define FEATURE_TEXT_PROTOCOL (PROFILE_TEXT && FEATURE_USB)
+#endif
+
+// TMC2209 configured and monitored over UART (Serial1). Off: the driver runs
+// in plain STEP/DIR mode with microstepping set by the MS pins.
+#ifndef FEATURE_TMC2209
+#define FEATURE_TMC2209 0
+#endif
+
+// Talk to a simulated register model instead of Serial1, for testing the
+// driver module with no driver attached
+#ifndef TMC2209_SIMULATED
+#define TMC2209_SIMULATED 0
+#endif
+
+#if FEATURE_TEXT_PROTOCOL
+#define TEXT_LOG(message) Serial.println(message)
+#else
+#define TEXT_LOG(message) ((void)0)
+#endif
+
+#endif // BUILD_PROFILE_H
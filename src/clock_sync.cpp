@@ -0,0 +1,205 @@
+#include "clock_sync.h"
+#include "command_processor.h"
+#include "config_manager.h"
+#include "jog_control.h"
+#include "menu_system.h"
+#include "motor_control.h"
+#include "sequencer.h"
+#include "trace.h"
+#include "trajectory.h"
+
+#if FEATURE_USB
+struct ScheduledCommand {
+  uint8_t id;
+  uint32_t atUs;
+  uint8_t command;
+  uint8_t payload[SCHEDULE_PAYLOAD];
+};
+
+// Waiting commands, earliest first
+static ScheduledCommand schedule[SCHEDULE_SIZE];
+static uint8_t scheduleCount = 0;
+
+static void sendScheduleReport(uint8_t status, uint8_t id, uint32_t atUs,
+                               uint32_t firedUs = 0) {
+  ScheduleReport report;
+  report.status = status;
+  report.id = id;
+  report.waiting = scheduleCount;
+  report.atUs = atUs;
+  report.firedUs = firedUs;
+  sendReport(REPORT_SCHEDULE, (const uint8_t *)&report, sizeof(report));
+}
+
+void handleClockSync(const char *data, int dataLen) {
+  ClockReport report;
+  report.receivedUs = micros();
+  report.token = *(uint32_t *)data;
+  report.sentUs = micros();
+  sendReport(REPORT_CLOCK, (const uint8_t *)&report, sizeof(report));
+}
+
+// Insert in time order; commands due at the same time keep arrival order.
+// Times compare as signed differences, valid while within the horizon.
+static void addCommand(const char *data) {
+  ScheduledCommand entry;
+  entry.id = data[1];
+  entry.atUs = *(uint32_t *)(data + 2);
+  entry.command = data[6];
+  memcpy(entry.payload, data + 7, SCHEDULE_PAYLOAD);
+
+  // Longer payloads would be cut short, and a nested schedule is pointless
+  if (commandPayloadLength(entry.command) > SCHEDULE_PAYLOAD ||
+      entry.command == CMD_SCHEDULE) {
+    sendScheduleReport(SCHEDULE_UNSUPPORTED, entry.id, entry.atUs);
+    return;
+  }
+  if ((int32_t)(entry.atUs - micros()) > (int32_t)SCHEDULE_HORIZON_US) {
+    sendScheduleReport(SCHEDULE_TOO_FAR, entry.id, entry.atUs);
+    return;
+  }
+  if (scheduleCount == SCHEDULE_SIZE) {
+    sendScheduleReport(SCHEDULE_FULL, entry.id, entry.atUs);
+    return;
+  }
+
+  uint8_t i = scheduleCount;
+  while (i > 0 && (int32_t)(entry.atUs - schedule[i - 1].atUs) < 0) {
+    schedule[i] = schedule[i - 1];
+    i--;
+  }
+  schedule[i] = entry;
+  scheduleCount++;
+  sendScheduleReport(SCHEDULE_WAITING, entry.id, entry.atUs);
+}
+
+void handleScheduleCommand(const char *data, int dataLen) {
+  uint8_t command = dataLen >= 1 ? (uint8_t)data[0] : SCHEDULE_QUERY;
+
+  switch (command) {
+  case SCHEDULE_ADD:
+    addCommand(data);
+    break;
+  case SCHEDULE_CLEAR:
+    scheduleCount = 0;
+    sendScheduleReport(SCHEDULE_CLEARED, 0, 0);
+    break;
+  default:
+    if (scheduleCount > 0) {
+      sendScheduleReport(SCHEDULE_WAITING, schedule[0].id, schedule[0].atUs);
+    } else {
+      sendScheduleReport(SCHEDULE_WAITING, 0, 0);
+    }
+    break;
+  }
+}
+
+// Microseconds until the next command is due; negative once it is late
+static int32_t untilNextUs() { return (int32_t)(schedule[0].atUs - micros()); }
+
+bool scheduleImminent() {
+  return scheduleCount > 0 && untilNextUs() < SCHEDULE_GUARD_MS * 1000L;
+}
+
+// Trace and report the cue as it starts, before a run that may block until
+// stopped; firedUs is when the work begins, after any setup
+static void cueStarted(const ScheduledCommand &entry) {
+  uint32_t firedUs = micros();
+  trace(TRACE_CUE, entry.command, min(firedUs - entry.atUs, 0xFFFFUL));
+  sendScheduleReport(SCHEDULE_FIRED, entry.id, entry.atUs, firedUs);
+}
+
+// Start a cued move or program straight on the motion calls, as a synced
+// start does. Their command handlers show a status message first, which
+// holds the display for a second and would leave the cue's timebase origin
+// stale. Returns false if the command starts no motion here.
+static bool startCuedMotion(const ScheduledCommand &entry) {
+  uint8_t programId = entry.payload[0] & ~RUN_PLAYLIST_FLAG;
+  bool playlist = entry.payload[0] & RUN_PLAYLIST_FLAG;
+  Playlist stored;
+
+  switch (entry.command) {
+  case CMD_RUN:
+    if (playlist ? !loadPlaylist(programId, &stored)
+                 : getProgramType(programId) != PROGRAM_TYPE_LOOP) {
+      return false; // The handler reports the invalid program
+    }
+    break;
+  case CMD_POS_WITH_SPEED:
+    break;
+  default:
+    return false;
+  }
+
+  jogHalt();
+  pvtHalt();
+  programRunning = true;
+  programPaused = false;
+  cueStarted(entry);
+  setMotionOrigin(entry.atUs);
+
+  if (entry.command == CMD_POS_WITH_SPEED) {
+    moveToPositionWithSpeed(*(uint16_t *)entry.payload,
+                            *(uint32_t *)(entry.payload + 2));
+  } else if (playlist) {
+    runPlaylist(programId);
+  } else {
+    runLoopProgram(programId);
+  }
+  return true;
+}
+
+// Remove and return the command due first
+static ScheduledCommand takeNext() {
+  ScheduledCommand entry = schedule[0];
+  scheduleCount--;
+  memmove(schedule, schedule + 1, scheduleCount * sizeof(ScheduledCommand));
+  return entry;
+}
+
+void scheduleService() {
+  if (scheduleCount == 0) {
+    return;
+  }
+
+  int32_t until = untilNextUs();
+  // Spin out the last stretch, unless jog or path steps need the passes
+  if (until > 0 && until <= SCHEDULE_SPIN_US && !jogActive() &&
+      !pvtActive()) {
+    while (untilNextUs() > 0) {
+    }
+  } else if (until > 0) {
+    return;
+  }
+
+  ScheduledCommand entry = takeNext();
+  if (entry.command == CMD_START) {
+    // Resume a paused run; the main loop picks it up on its next pass
+    programRunning = true;
+    programPaused = false;
+    if (inPauseMenu) {
+      exitPauseMenu();
+    }
+    cueStarted(entry);
+  } else if (!startCuedMotion(entry)) {
+    // Anything else runs as if just received
+    cueStarted(entry);
+    processCommandCode(entry.command, (char *)entry.payload,
+                       commandPayloadLength(entry.command));
+  }
+  clearMotionOrigin();
+}
+
+// A blocking run only returns to loop() when it ends, so a cue falling due
+// meanwhile waits for it. Another move has to wait anyway, but a cued stop
+// can end the run on time from the step engine's yield.
+void scheduleServiceInRun() {
+  if (scheduleCount == 0 || untilNextUs() > 0 ||
+      schedule[0].command != CMD_STOP) {
+    return;
+  }
+  ScheduledCommand entry = takeNext();
+  cueStarted(entry);
+  processCommandCode(entry.command, (char *)entry.payload, 0);
+}
+#endif // FEATURE_USB
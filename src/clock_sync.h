@@ -0,0 +1,68 @@
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+
+#include <Arduino.h>
+
+#include "build_profile.h"
+
+// Host clock sync and scheduled commands. The host stamps each
+// CMD_CLOCK_SYNC and the device answers with when it received it and when it
+// replied, on its micros() timebase. From the exchanges with the shortest
+// round trip the host fits the offset and drift between the two clocks
+// (NTP-style), then sends commands wrapped in CMD_SCHEDULE with the micros()
+// time to run them at. They wait in a time-ordered queue and fire from
+// loop(): slow work such as a display refresh is held back while one is
+// close, and the last stretch is spun out, so transport jitter never reaches
+// the cue.
+const uint8_t SCHEDULE_SIZE = 6;        // Commands waiting at most
+const uint8_t SCHEDULE_PAYLOAD = 10;    // Longest payload a command may have
+const uint16_t SCHEDULE_GUARD_MS = 40;  // No display refresh this near a cue
+const uint16_t SCHEDULE_SPIN_US = 2000; // Busy-wait for a cue this near
+// Furthest ahead a command can be set; micros() wraps every 71 minutes
+const uint32_t SCHEDULE_HORIZON_US = 1800000000UL;
+
+// Schedule sub-commands (CMD_SCHEDULE)
+enum ScheduleCommand {
+  SCHEDULE_ADD = 0,   // id(1), atUs(4), command(1), payload(SCHEDULE_PAYLOAD)
+  SCHEDULE_CLEAR = 1, // Drop every waiting command
+  SCHEDULE_QUERY = 2
+};
+
+enum ScheduleStatus {
+  SCHEDULE_WAITING = 0,    // Queued (query: id/atUs of the next one due)
+  SCHEDULE_FIRED = 1,      // Command starting (firedUs: after its setup)
+  SCHEDULE_FULL = 2,       // Not queued, no free entry
+  SCHEDULE_TOO_FAR = 3,    // Not queued, more than SCHEDULE_HORIZON_US ahead
+  SCHEDULE_CLEARED = 4,
+  SCHEDULE_UNSUPPORTED = 5 // Not queued, payload too long or CMD_SCHEDULE
+};
+
+struct ClockReport {
+  uint32_t token;      // Echoed from CMD_CLOCK_SYNC
+  uint32_t receivedUs; // micros() when the command was read
+  uint32_t sentUs;     // micros() when the reply was sent
+};
+
+struct ScheduleReport {
+  uint8_t status;   // ScheduleStatus
+  uint8_t id;       // Host tag of the command concerned
+  uint8_t waiting;  // Commands still queued
+  uint32_t atUs;    // When it was due
+  uint32_t firedUs; // When it ran (SCHEDULE_FIRED)
+};
+
+#if FEATURE_USB
+// Function declarations
+void handleClockSync(const char *data, int dataLen);
+void handleScheduleCommand(const char *data, int dataLen);
+void scheduleService();      // Call every loop() pass; runs due commands
+void scheduleServiceInRun(); // Call from the motion yield; runs a due stop
+bool scheduleImminent();     // A cue is due within SCHEDULE_GUARD_MS
+#else
+// No host link: nothing is ever scheduled
+inline void scheduleService() {}
+inline void scheduleServiceInRun() {}
+inline bool scheduleImminent() { return false; }
+#endif
+
+#endif // CLOCK_SYNC_H
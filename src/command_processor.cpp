@@ -1,52 +1,166 @@
 #include "command_processor.h"
+#include "clock_sync.h"
 #include "config_manager.h"
 #include "display_manager.h"
+#include "homing.h"
+#include "jog_control.h"
+#include "menu_system.h"
 #include "motor_control.h"
+#include "program_sync.h"
+#include "recorder.h"
+#include "self_test.h"
+#include "sequencer.h"
+#include "sync_line.h"
+#include "tmc_driver.h"
+#include "trace.h"
+#include "trajectory.h"
 
-// Command codes for memory efficiency
-enum CommandCode {
-  CMD_RUN = 3,
-  CMD_START = 4,
-  CMD_STOP = 5,
-  CMD_SETHOME = 8,
-  CMD_LOOP_PROGRAM = 9,
-  CMD_DEBUG_INFO = 14, // Debug info
-  CMD_POS_WITH_SPEED =
-      15 // Position with custom speed (handles both move and home)
-};
+#if FEATURE_USB
+// Send one binary report frame over WebUSB
+void sendReport(uint8_t type, const uint8_t *payload, uint8_t length) {
+  WebUSBSerial.write(REPORT_MAGIC);
+  WebUSBSerial.write(type);
+  WebUSBSerial.write(length);
+  WebUSBSerial.write(payload, length);
+  WebUSBSerial.flush();
+}
+
+// Payload bytes following each command code. The host pads every command to
+// this length, which lets the stream be split without delimiters. Unknown
+// codes carry no payload.
+uint8_t commandPayloadLength(uint8_t cmdCode) {
+  switch (cmdCode) {
+  case CMD_RUN:
+    return 1;
+  case CMD_LOOP_PROGRAM:
+    return 15;
+  case CMD_POS_WITH_SPEED:
+    return 6;
+  case CMD_SELF_TEST:
+  case CMD_RECORD:
+    return 3;
+  case CMD_HOMING:
+    return 10;
+  case CMD_PROGRAM_SYNC:
+    return 16;
+  case CMD_PLAYLIST:
+    return 35;
+  case CMD_JOG:
+  case CMD_CLOCK_SYNC:
+    return 4;
+  case CMD_SYNC_LINE:
+    return 7;
+  case CMD_DRIVER:
+    return 6;
+  case CMD_SCHEDULE:
+    return 7 + SCHEDULE_PAYLOAD;
+  case CMD_PVT:
+    return 2 + PVT_KNOTS_PER_COMMAND * sizeof(PvtKnot);
+  default:
+    return 0;
+  }
+}
+
+// Command being assembled from the USB stream; a command may straddle USB
+// packets, so bytes are collected here until its payload is complete
+static uint8_t commandBuffer[1 + MAX_COMMAND_PAYLOAD];
+static uint8_t commandReceived = 0;
+static uint32_t commandStartMs = 0;
+
+// Read the available USB bytes and run every complete command in order
+void processCommandInput() {
+  // A payload that never completed: drop it so the stream resyncs
+  if (commandReceived > 0 && millis() - commandStartMs > COMMAND_TIMEOUT_MS) {
+    commandReceived = 0;
+  }
+
+  while (WebUSBSerial.available()) {
+    uint8_t value = WebUSBSerial.read();
+    if (commandReceived == 0) {
+      if (value >= 32) {
+        continue; // Not a command code
+      }
+      commandStartMs = millis();
+    }
+    commandBuffer[commandReceived++] = value;
+
+    uint8_t cmdCode = commandBuffer[0];
+    uint8_t payloadLength = commandPayloadLength(cmdCode);
+    if (commandReceived < 1 + payloadLength) {
+      continue;
+    }
+    commandReceived = 0;
+
+    // The periodic ping and clock exchanges would push everything else out
+    // of the trace within seconds
+    bool traced = cmdCode != CMD_DEBUG_INFO && cmdCode != CMD_CLOCK_SYNC;
+    uint32_t received = millis();
+    if (traced) {
+      trace(TRACE_COMMAND, cmdCode, payloadLength);
+    }
+    processCommandCode(cmdCode, (char *)commandBuffer + 1, payloadLength);
+    if (traced) {
+      trace(TRACE_COMMAND_DONE, cmdCode, min(millis() - received, 0xFFFFUL));
+    }
+  }
+}
 
 // Process numeric command codes (binary format for maximum efficiency)
 void processCommandCode(uint8_t cmdCode, char *data, int dataLen) {
   switch (cmdCode) {
   case CMD_RUN: {
-    // Binary format: programId(1)
+    // Binary format: programId(1); RUN_PLAYLIST_FLAG selects a playlist
     uint8_t programId = *(uint8_t *)data;
 
+    jogHalt();
+    pvtHalt();
     programPaused = false;
     displayMessage(F("Running"));
 
+    if (programId & RUN_PLAYLIST_FLAG) {
+      programRunning = true;
+      runPlaylist(programId & ~RUN_PLAYLIST_FLAG);
+      if (!motionPaused()) {
+        displayMessage(F("Done"));
+      }
+      break;
+    }
+
     uint8_t programType = getProgramType(programId);
 
     if (programType == PROGRAM_TYPE_LOOP) {
       runLoopProgram(programId);
-      displayMessage(F("Done"));
+      if (!motionPaused()) {
+        displayMessage(F("Done"));
+      }
     } else {
       displayMessage(F("Invalid Program"));
     }
     break;
   }
   case CMD_START:
+    // Also resumes a paused run (picked up by the main loop)
     programRunning = true;
+    programPaused = false;
+    if (inPauseMenu) {
+      exitPauseMenu();
+    }
     displayMessage(F("Start"));
     break;
   case CMD_STOP:
+    jogHalt();
+    pvtHalt();
+    dropPausedRun();
     programRunning = false;
     programPaused = false;
+    if (inPauseMenu) {
+      exitPauseMenu();
+    }
     displayMessage(F("Stop"));
     break;
   case CMD_SETHOME:
     displayMessage(F("Set Home"));
-    currentPosition = 0;
+    setPositionMicrosteps(0);
     break;
   case CMD_LOOP_PROGRAM: {
     // Binary format: programId(1), name(8), steps(2), delayMs(4)
@@ -67,24 +181,110 @@ void processCommandCode(uint8_t cmdCode, char *data, int dataLen) {
     displayMessage(F("Program Saved"));
     break;
   }
+  case CMD_PLAYLIST: {
+    // Binary format: playlistId(1), name(8), flags(1), count(1),
+    // entries(MAX_PLAYLIST_ENTRIES x programId(1), repeats(1), dwellMs(2))
+    uint8_t playlistId = *(uint8_t *)data;
+    Playlist playlist;
+    memcpy(playlist.name, data + 1, 8);
+    playlist.name[8] = '\0';
+    playlist.flags = data[9];
+    playlist.count = min((uint8_t)data[10], (uint8_t)MAX_PLAYLIST_ENTRIES);
+    memcpy(playlist.entries, data + 11, sizeof(playlist.entries));
+
+    savePlaylist(playlistId, playlist);
+    buildMenuItems();
+    displayMessage(F("Playlist Saved"));
+    break;
+  }
+  case CMD_JOG: {
+    // Binary format: velocity(2, signed microsteps/s), accel(2, microsteps/s^2)
+    int16_t velocity = *(int16_t *)data;
+    uint16_t accel = dataLen >= 4 ? *(uint16_t *)(data + 2) : 0;
+    pvtHalt();
+    setJogVelocity(velocity, accel);
+    break;
+  }
   case CMD_DEBUG_INFO: {
     // Simple ping response for connection checking
-    Serial.println("PONG");
+    TEXT_LOG(F("PONG"));
     break;
   }
   case CMD_POS_WITH_SPEED: {
     // Binary format: position(2), speed(4)
     uint16_t position = *(uint16_t *)data;
     uint32_t speedMs = *(uint32_t *)(data + 2);
-    display.print(F("Move\n"));
-    display.print("P: " + String(position) + ", S: " + speedMs);
+    displayMessage(F("Move"), 0);
+    jogHalt();
+    pvtHalt();
     programRunning = true;
     moveToPositionWithSpeed(position, speedMs);
     break;
   }
+  case CMD_SELF_TEST: {
+    // Binary format: flags(1), msPerRate(2)
+    uint8_t flags = dataLen >= 1 ? *(uint8_t *)data : SELF_TEST_DRY_RUN;
+    uint16_t msPerRate = dataLen >= 3 ? *(uint16_t *)(data + 1) : 0;
+    jogHalt();
+    pvtHalt();
+    runSelfTest(flags, msPerRate);
+    break;
+  }
+  case CMD_PROGRAM_SYNC:
+    // Binary format: sub-command(1), sub-command payload
+    handleProgramSync(data, dataLen);
+    break;
+  case CMD_RECORD:
+    // Binary format: sub-command(1), sub-command payload
+    if (dataLen >= 1 && data[0] == RECORD_PLAY) {
+      jogHalt();
+      pvtHalt();
+      displayMessage(F("Playback"));
+      handleRecordCommand(data, dataLen);
+      displayMessage(F("Done"));
+    } else {
+      handleRecordCommand(data, dataLen);
+    }
+    break;
+  case CMD_TRACE_DUMP:
+    sendTraceDump();
+    break;
+  case CMD_HOMING:
+    // Binary format: sub-command(1), sub-command payload
+    if (data[0] == HOMING_RUN) {
+      jogHalt();
+      pvtHalt();
+      displayMessage(F("Homing"));
+      handleHomingCommand(data, dataLen);
+      displayMessage(F("Done"));
+    } else {
+      handleHomingCommand(data, dataLen);
+    }
+    break;
+  case CMD_PVT:
+    // Binary format: sub-command(1), sub-command payload
+    handlePvtCommand(data, dataLen);
+    break;
+  case CMD_SYNC_LINE:
+    // Binary format: sub-command(1), sub-command payload
+    handleSyncLineCommand(data, dataLen);
+    break;
+  case CMD_DRIVER:
+    // Binary format: sub-command(1), sub-command payload
+    handleDriverCommand(data, dataLen);
+    break;
+  case CMD_CLOCK_SYNC:
+    // Binary format: token(4), echoed back with the device timestamps
+    handleClockSync(data, dataLen);
+    break;
+  case CMD_SCHEDULE:
+    // Binary format: sub-command(1), sub-command payload
+    handleScheduleCommand(data, dataLen);
+    break;
   default:
     displayMessage(F("Unknown Cmd"));
-    Serial.println("Unknown Command"); // End with newline
+    TEXT_LOG(F("Unknown Command"));
     break;
   }
 }
+#endif // FEATURE_USB
@@ -3,12 +3,76 @@
 
 #include <Arduino.h>
 
+#include "build_profile.h"
+
+#if FEATURE_USB
+#include <WebUSB.h>
+#endif
+
+// Binary report frames sent to the host: magic(1), type(1), length(1),
+// payload(length). Text output never starts with the magic byte.
+const uint8_t REPORT_MAGIC = 0xA5;
+
+// Report types
+enum ReportType {
+  REPORT_SELF_TEST = 1, // Step rate sweep results (see self_test.h)
+  REPORT_EEPROM = 2,    // Queued EEPROM writes finished (see eeprom_queue.h)
+  REPORT_SYNC = 3,      // Program sync diff/commit result (see program_sync.h)
+  REPORT_RECORDING = 4, // Recorded move status (see recorder.h)
+  REPORT_TRACE = 5,     // Event trace dump (see trace.h)
+  REPORT_HOMING = 6,    // Homing result and settings (see homing.h)
+  REPORT_PVT = 7,       // PVT path buffer state (see trajectory.h)
+  REPORT_SYNC_LINE = 8, // Sync line mode and tick statistics (see sync_line.h)
+  REPORT_DRIVER = 9,    // TMC2209 status and settings (see tmc_driver.h)
+  REPORT_CLOCK = 10,    // Clock sync timestamps (see clock_sync.h)
+  REPORT_SCHEDULE = 11  // Scheduled command queued/fired (see clock_sync.h)
+};
+
+// Commands are a code below 32 followed by a fixed-length payload (see
+// commandPayloadLength), so several commands can share one USB transfer
+const uint8_t MAX_COMMAND_PAYLOAD = 48;
+const uint16_t COMMAND_TIMEOUT_MS = 100; // Drop a partial command after this
+
 // External variables
 extern bool programmingMode;
 extern long currentPosition;
 extern bool programRunning;
 
+#if FEATURE_USB
+extern WebUSB WebUSBSerial;
+
+// Command codes for memory efficiency
+enum CommandCode {
+  CMD_RUN = 3,
+  CMD_START = 4,
+  CMD_STOP = 5,
+  CMD_SETHOME = 8,
+  CMD_LOOP_PROGRAM = 9,
+  CMD_DEBUG_INFO = 14, // Debug info
+  CMD_POS_WITH_SPEED =
+      15, // Position with custom speed (handles both move and home)
+  CMD_SELF_TEST = 17,   // Step rate sweep, answered with REPORT_SELF_TEST
+  CMD_PROGRAM_SYNC = 18, // Batch program sync transaction (see program_sync.h)
+  CMD_PLAYLIST = 19,     // Store a playlist
+  CMD_JOG = 20,          // Velocity setpoint for jog mode
+  CMD_RECORD = 21,       // Record/play back jogged moves (see recorder.h)
+  CMD_TRACE_DUMP = 22,   // Send the event trace, answered with REPORT_TRACE
+  CMD_HOMING = 23,       // Limit-switch homing (see homing.h)
+  CMD_PVT = 24,          // Stream PVT path knots (see trajectory.h)
+  CMD_SYNC_LINE = 25,    // Multi-unit sync line (see sync_line.h)
+  CMD_DRIVER = 26,       // TMC2209 settings and status (see tmc_driver.h)
+  CMD_CLOCK_SYNC = 27,   // Clock sync exchange, answered with REPORT_CLOCK
+  CMD_SCHEDULE = 28      // Run a command at a set time (see clock_sync.h)
+};
+
 // Function declarations
 void processCommandCode(uint8_t cmdCode, char *data, int dataLen);
+uint8_t commandPayloadLength(uint8_t cmdCode);
+void processCommandInput(); // Read available USB bytes, run complete commands
+void sendReport(uint8_t type, const uint8_t *payload, uint8_t length);
+#else
+// No host link: reports are dropped, command handlers are never reached
+inline void sendReport(uint8_t type, const uint8_t *payload, uint8_t length) {}
+#endif
 
 #endif // COMMAND_PROCESSOR_H
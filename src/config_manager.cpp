@@ -1,11 +1,13 @@
 #include "config_manager.h"
+#include "eeprom_queue.h"
+#include "program_sync.h"
 
 // Global configuration instance
 SliderConfig config;
 
 // Load configuration from EEPROM
 void loadConfig() {
-  EEPROM.get(CONFIG_ADDR, config);
+  eepromGet(CONFIG_ADDR, config);
 
   if (config.magic != CONFIG_MAGIC) {
     // Initialize default configuration
@@ -13,21 +15,18 @@ void loadConfig() {
     config.programCount = 0;
     saveConfig();
   }
-}
-
-// Save configuration to EEPROM
-void saveConfig() {
-  EEPROM.put(CONFIG_ADDR, config);
 
-  // Verify the save
-  SliderConfig temp;
-  EEPROM.get(CONFIG_ADDR, temp);
+  // Finish a batch program sync interrupted by a reset
+  recoverProgramSync();
 }
 
+// Save configuration to EEPROM (queued; verified by the write queue)
+void saveConfig() { eepromPut(CONFIG_ADDR, config); }
+
 // Save a loop program (very efficient storage)
 void saveLoopProgram(uint8_t programId, const char *name, LoopProgram program) {
   if (programId >= MAX_PROGRAMS) {
-    Serial.println("ERROR: Program ID out of range");
+    TEXT_LOG(F("ERROR: Program ID out of range"));
     return;
   }
 
@@ -36,12 +35,13 @@ void saveLoopProgram(uint8_t programId, const char *name, LoopProgram program) {
   // Save program header
   ProgramHeader header;
   header.type = PROGRAM_TYPE_LOOP;
+  header.reserved = 0;
   strncpy(header.name, name, 8);
   header.name[8] = '\0';
-  EEPROM.put(addr, header);
+  eepromPut(addr, header);
 
   // Save loop parameters (very compact!)
-  EEPROM.put(addr + sizeof(ProgramHeader), program);
+  eepromPut(addr + sizeof(ProgramHeader), program);
 
   // Update program count if necessary
   if (programId >= config.programCount) {
@@ -56,10 +56,10 @@ bool loadLoopProgram(uint8_t programId, LoopProgram *program) {
 
   // Check program type
   ProgramHeader header;
-  EEPROM.get(addr, header);
+  eepromGet(addr, header);
 
   // Load loop parameters
-  EEPROM.get(addr + sizeof(ProgramHeader), *program);
+  eepromGet(addr + sizeof(ProgramHeader), *program);
   return true;
 }
 
@@ -70,7 +70,7 @@ uint8_t getProgramType(uint8_t programId) {
 
   int addr = PROGRAMS_ADDR + (programId * PROGRAM_SIZE);
   ProgramHeader header;
-  EEPROM.get(addr, header);
+  eepromGet(addr, header);
   return header.type;
 }
 
@@ -83,7 +83,7 @@ void loadProgramName(uint8_t programId, char *name) {
 
   int addr = PROGRAMS_ADDR + (programId * PROGRAM_SIZE);
   ProgramHeader header;
-  EEPROM.get(addr, header);
+  eepromGet(addr, header);
 
   // Check if we have a valid name
   if (header.name[0] != '\0' && header.name[0] >= 32 && header.name[0] <= 126) {
@@ -101,10 +101,68 @@ void saveProgramName(uint8_t programId, const char *name) {
 
   int addr = PROGRAMS_ADDR + (programId * PROGRAM_SIZE);
   ProgramHeader header;
-  EEPROM.get(addr, header);
+  eepromGet(addr, header);
 
   // Update name in header
   strncpy(header.name, name, 8);
   header.name[8] = '\0';
-  EEPROM.put(addr, header);
+  eepromPut(addr, header);
+}
+
+// Save a playlist
+void savePlaylist(uint8_t playlistId, const Playlist &playlist) {
+  if (playlistId >= MAX_PLAYLISTS)
+    return;
+
+  eepromPut(PLAYLISTS_ADDR + playlistId * sizeof(Playlist), playlist);
+}
+
+// Load a playlist; false if the slot is empty or out of range
+bool loadPlaylist(uint8_t playlistId, Playlist *playlist) {
+  if (playlistId >= MAX_PLAYLISTS)
+    return false;
+
+  eepromGet(PLAYLISTS_ADDR + playlistId * sizeof(Playlist), *playlist);
+  playlist->name[8] = '\0';
+  return playlist->count > 0 && playlist->count <= MAX_PLAYLIST_ENTRIES;
+}
+
+// Save homing settings
+void saveHomingConfig(const HomingConfig &homing) {
+  HomingConfig stored = homing;
+  stored.magic = HOMING_MAGIC;
+  eepromPut(HOMING_ADDR, stored);
+}
+
+// Load homing settings, falling back to defaults if never configured
+void loadHomingConfig(HomingConfig *homing) {
+  eepromGet(HOMING_ADDR, *homing);
+  if (homing->magic != HOMING_MAGIC || homing->seekVelocity == 0 ||
+      homing->latchVelocity == 0) {
+    homing->seekVelocity = 4000; // 500 steps/s
+    homing->latchVelocity = 200; // 25 steps/s
+    homing->accel = 8000;
+    homing->backoff = 400; // 50 steps
+    homing->flags = 0;
+    homing->magic = HOMING_MAGIC;
+  }
+}
+
+void saveDriverConfig(const DriverConfig &driver) {
+  DriverConfig stored = driver;
+  stored.magic = DRIVER_MAGIC;
+  eepromPut(DRIVER_ADDR, stored);
+}
+
+// Load driver settings, falling back to defaults if never configured
+void loadDriverConfig(DriverConfig *driver) {
+  eepromGet(DRIVER_ADDR, *driver);
+  if (driver->magic != DRIVER_MAGIC || driver->runCurrent > 31 ||
+      driver->holdCurrent > 31) {
+    driver->runCurrent = 16;
+    driver->holdCurrent = 8;
+    driver->stealthMaxVelocity = 1600; // 200 steps/s
+    driver->flags = 0;
+    driver->magic = DRIVER_MAGIC;
+  }
 }
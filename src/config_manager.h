@@ -4,6 +4,8 @@
 #include <Arduino.h>
 #include <EEPROM.h>
 
+#include "build_profile.h"
+
 // Simplified configuration structure - only stores program count
 struct SliderConfig {
   uint16_t magic;       // Magic number for validation
@@ -45,6 +47,68 @@ const int PROGRAMS_ADDR = CONFIG_ADDR + sizeof(SliderConfig);
 const int PROGRAM_SIZE = 128; // Fixed size per program slot
 const int TOTAL_PROGRAM_STORAGE = MAX_PROGRAMS * PROGRAM_SIZE;
 
+// Reserved for the program sync commit marker (see program_sync.h)
+const int SYNC_MARKER_ADDR = PROGRAMS_ADDR + TOTAL_PROGRAM_STORAGE;
+const int SYNC_MARKER_SIZE = 8;
+
+// Playlists: ordered stored programs with repeat counts and transition dwell
+const int MAX_PLAYLISTS = 2;
+const int MAX_PLAYLIST_ENTRIES = 6;
+const uint8_t PLAYLIST_FLAG_LOOP = 0x01; // Start over after the last entry
+
+struct PlaylistEntry {
+  uint8_t programId; // Program slot to run
+  uint8_t repeats;   // Forward/backward cycles (0 treated as 1)
+  uint16_t dwellMs;  // Hold after this entry before the next starts
+};
+
+struct Playlist {
+  char name[9]; // Playlist name (8 chars + null)
+  uint8_t count; // Entries in use (0 or 0xFF = empty slot)
+  uint8_t flags; // PLAYLIST_FLAG_*
+  PlaylistEntry entries[MAX_PLAYLIST_ENTRIES];
+};
+
+const int PLAYLISTS_ADDR = SYNC_MARKER_ADDR + SYNC_MARKER_SIZE;
+
+// Limit-switch homing parameters (see homing.h)
+const uint8_t HOMING_MAGIC = 0x4D;
+const uint8_t HOMING_FLAG_POSITIVE = 0x01; // Switch at the positive end
+
+struct HomingConfig {
+  uint16_t seekVelocity;  // Fast approach, microsteps/s
+  uint16_t latchVelocity; // Slow re-approach that latches the edge
+  uint16_t accel;         // Ramp for the fast phases, microsteps/s^2
+  uint16_t backoff;       // Distance backed off the switch, microsteps
+  uint8_t flags;          // HOMING_FLAG_*
+  uint8_t magic;          // HOMING_MAGIC once configured
+};
+
+const int HOMING_ADDR = PLAYLISTS_ADDR + MAX_PLAYLISTS * sizeof(Playlist);
+
+// TMC2209 UART driver settings (see tmc_driver.h)
+const uint8_t DRIVER_MAGIC = 0x54;
+const uint8_t DRIVER_FLAG_SPREADCYCLE = 0x01; // SpreadCycle at every speed
+
+struct DriverConfig {
+  uint8_t runCurrent;          // IRUN, 0-31 (32nds of full scale)
+  uint8_t holdCurrent;         // IHOLD, 0-31, at standstill
+  uint16_t stealthMaxVelocity; // StealthChop up to this, microsteps/s
+                               // (0 = StealthChop at every speed)
+  uint8_t flags;               // DRIVER_FLAG_*
+  uint8_t magic;               // DRIVER_MAGIC once configured
+};
+
+// End of the EEPROM; the space after the homing settings holds a recorded
+// move (see recorder.h) and the driver settings sit in the last bytes, so
+// the recording keeps its address
+#ifdef E2END
+const int EEPROM_END = E2END + 1;
+#else
+const int EEPROM_END = 1024;
+#endif
+const int DRIVER_ADDR = EEPROM_END - sizeof(DriverConfig);
+
 // Function declarations
 void loadConfig();
 void saveConfig();
@@ -56,4 +120,16 @@ uint8_t getProgramType(uint8_t programId);
 void loadProgramName(uint8_t programId, char *name);
 void saveProgramName(uint8_t programId, const char *name);
 
+// Playlist functions
+void savePlaylist(uint8_t playlistId, const Playlist &playlist);
+bool loadPlaylist(uint8_t playlistId, Playlist *playlist);
+
+// Homing settings (defaults until configured)
+void saveHomingConfig(const HomingConfig &homing);
+void loadHomingConfig(HomingConfig *homing);
+
+// Driver settings (defaults until configured)
+void saveDriverConfig(const DriverConfig &driver);
+void loadDriverConfig(DriverConfig *driver);
+
 #endif // CONFIG_MANAGER_H
@@ -1,11 +1,23 @@
 #include "display_manager.h"
 #include "menu_system.h"
+#include "trace.h"
 
+// Display variables
+unsigned long lastDisplayUpdate = 0;
+
+#if FEATURE_DISPLAY
 // OLED display instance
 Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
 
-// Display variables
-unsigned long lastDisplayUpdate = 0;
+// Push the frame buffer to the panel, tracing the transfer if it was slow
+static void flushDisplay() {
+  uint32_t start = micros();
+  display.display();
+  uint32_t elapsed = micros() - start;
+  if (elapsed >= TRACE_SLOW_DISPLAY_US) {
+    trace(TRACE_DISPLAY, 0, elapsed > 0xFFFF ? 0xFFFF : elapsed);
+  }
+}
 
 // Setup display
 void setupDisplay() {
@@ -14,8 +26,10 @@ void setupDisplay() {
     // Display failed to initialize, continue without display
   }
 
+#if FEATURE_BOOT_ANIMATION
   // Play cute boot animation
   playBootAnimation();
+#endif
 }
 
 // Update display periodically
@@ -25,13 +39,16 @@ void updateDisplay(long position) {
   display.setTextColor(SSD1306_WHITE);
   display.setCursor(0, 0);
 
+#if FEATURE_MENU
   if (inPauseMenu && !programmingMode) {
     // Pause menu display
     displayPauseMenu();
   } else if (inMenuMode && !programmingMode) {
     // Main menu display
     displayMenu();
-  } else if (programmingMode) {
+  } else
+#endif
+  if (programmingMode) {
     // Programming mode display
     display.print(F("WebUSB\n"));
     display.print(F("Connected"));
@@ -62,7 +79,7 @@ void updateDisplay(long position) {
     display.print(position);
   }
 
-  display.display();
+  flushDisplay();
 }
 
 // Display a message on screen
@@ -72,7 +89,7 @@ void displayMessage(const __FlashStringHelper *message, int duration) {
   display.setTextColor(SSD1306_WHITE);
   display.setCursor(0, 4);
   display.print(message);
-  display.display();
+  flushDisplay();
 
   if (duration > 0) {
     delay(duration);
@@ -87,7 +104,7 @@ void displayMessage(const String message, int duration) {
   display.setTextColor(SSD1306_WHITE);
   display.setCursor(0, 4);
   display.print(message);
-  display.display();
+  flushDisplay();
 
   if (duration > 0) {
     delay(duration);
@@ -95,6 +112,20 @@ void displayMessage(const String message, int duration) {
   }
 }
 
+// Position info screen (menu "INFO" item)
+void displayInfo() {
+  display.clearDisplay();
+  display.setTextSize(1);
+  display.setTextColor(SSD1306_WHITE);
+
+  display.setCursor(0, 0);
+  display.print(F("POS:"));
+  display.print(currentPosition);
+
+  flushDisplay();
+}
+
+#if FEATURE_BOOT_ANIMATION
 // Play boot animation
 void playBootAnimation() {
   display.clearDisplay();
@@ -166,7 +197,9 @@ void playBootAnimation() {
 
   delay(1000);
 }
+#endif
 
+#if FEATURE_MENU
 // Display main menu
 void displayMenu() {
   if (menuItemCount == 0) {
@@ -208,3 +241,5 @@ void displayPauseMenu() {
   display.print(pauseMenuIndex + 1);
   display.print(F("/2"));
 }
+#endif
+#endif // FEATURE_DISPLAY
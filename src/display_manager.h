@@ -1,12 +1,16 @@
 #ifndef DISPLAY_MANAGER_H
 #define DISPLAY_MANAGER_H
 
-#include <Adafruit_GFX.h>
-#include <Adafruit_SSD1306.h>
 #include <Arduino.h>
-#include <Wire.h>
 
 #include "config_manager.h"
+#include "build_profile.h"
+
+#if FEATURE_DISPLAY
+#include <Adafruit_GFX.h>
+#include <Adafruit_SSD1306.h>
+#include <Wire.h>
+#endif
 
 // OLED display configuration
 const int SCREEN_WIDTH = 96;
@@ -16,20 +20,32 @@ const int SCREEN_ADDRESS = 0x3C;
 const unsigned long DISPLAY_UPDATE_INTERVAL = 500; // Update every 500ms
 
 // External variables
-extern Adafruit_SSD1306 display;
 extern unsigned long lastDisplayUpdate;
 extern bool programmingMode;
 extern long currentPosition;
 extern bool programRunning;
 extern bool programPaused;
 
+#if FEATURE_DISPLAY
+extern Adafruit_SSD1306 display;
+
 // Function declarations
 void setupDisplay();
 void updateDisplay(long position = currentPosition);
 void displayMessage(const __FlashStringHelper *message, int duration = 1000);
 void displayMessage(const String message, int duration = 1000);
+void displayInfo(); // Position info screen
 void playBootAnimation();
 void displayMenu();
 void displayPauseMenu();
+#else
+// No OLED: display calls compile to nothing
+inline void setupDisplay() {}
+inline void updateDisplay(long position = currentPosition) {}
+inline void displayMessage(const __FlashStringHelper *message,
+                           int duration = 1000) {}
+inline void displayMessage(const String message, int duration = 1000) {}
+inline void displayInfo() {}
+#endif
 
 #endif // DISPLAY_MANAGER_H
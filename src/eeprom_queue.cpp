@@ -0,0 +1,263 @@
+#include "eeprom_queue.h"
+#include "command_processor.h"
+#include "trace.h"
+#include <EEPROM.h>
+
+// Pending write request; its bytes follow in order in the data ring
+struct EepromJob {
+  uint16_t addr;
+  uint8_t len;
+};
+
+static EepromJob jobs[EEPROM_QUEUE_JOBS];
+static uint8_t jobHead = 0;
+static volatile uint8_t jobTail = 0;
+static volatile uint8_t jobCount = 0;
+static volatile uint8_t jobOffset = 0; // Bytes of the tail job consumed
+
+static uint8_t dataRing[EEPROM_QUEUE_BYTES];
+static uint8_t dataHead = 0;
+static volatile uint8_t dataTail = 0;
+static volatile uint8_t dataCount = 0;
+
+// Results accumulated until the queue drains
+static volatile bool drained = true;
+static volatile bool failed = false;
+static volatile uint16_t failAddr = 0;
+static volatile uint16_t bytesWritten = 0;
+static volatile uint16_t bytesSkipped = 0;
+
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+
+// Last byte handed to the hardware, checked on the next ready interrupt
+static volatile bool verifyPending = false;
+static volatile uint16_t verifyAddr = 0;
+static volatile uint8_t verifyValue = 0;
+
+static inline uint8_t readEepromByte(uint16_t addr) {
+  EEAR = addr;
+  EECR |= _BV(EERE);
+  return EEDR;
+}
+
+// EEPROM ready: verify the previous byte, then start the next changed one
+ISR(EE_READY_vect) {
+  if (verifyPending) {
+    verifyPending = false;
+    if (readEepromByte(verifyAddr) != verifyValue && !failed) {
+      failed = true;
+      failAddr = verifyAddr;
+    }
+  }
+
+  while (jobCount > 0) {
+    EepromJob &job = jobs[jobTail];
+    if (jobOffset == job.len) {
+      jobOffset = 0;
+      jobTail = (jobTail + 1) % EEPROM_QUEUE_JOBS;
+      jobCount--;
+      continue;
+    }
+
+    uint16_t addr = job.addr + jobOffset;
+    uint8_t value = dataRing[dataTail];
+    dataTail = (dataTail + 1) % EEPROM_QUEUE_BYTES;
+    dataCount--;
+    jobOffset++;
+
+    if (readEepromByte(addr) == value) {
+      bytesSkipped++;
+      continue;
+    }
+
+    // Atomic erase + write (EEPM = 0), EEPE within four cycles of EEMPE
+    EEAR = addr;
+    EEDR = value;
+    EECR = _BV(EERIE) | _BV(EEMPE);
+    EECR |= _BV(EEPE);
+
+    verifyPending = true;
+    verifyAddr = addr;
+    verifyValue = value;
+    bytesWritten++;
+    return;
+  }
+
+  // Nothing left: stop the interrupt until the next write is queued
+  EECR &= ~_BV(EERIE);
+  drained = true;
+}
+
+static inline void kickQueue() { EECR |= _BV(EERIE); }
+#else
+// No EEPROM-ready interrupt: drain synchronously with the same semantics
+static void kickQueue() {
+  while (jobCount > 0) {
+    EepromJob &job = jobs[jobTail];
+    for (; jobOffset < job.len; jobOffset++) {
+      uint16_t addr = job.addr + jobOffset;
+      uint8_t value = dataRing[dataTail];
+      dataTail = (dataTail + 1) % EEPROM_QUEUE_BYTES;
+      dataCount--;
+      if (EEPROM.read(addr) == value) {
+        bytesSkipped++;
+        continue;
+      }
+      EEPROM.write(addr, value);
+      bytesWritten++;
+      if (EEPROM.read(addr) != value && !failed) {
+        failed = true;
+        failAddr = addr;
+      }
+    }
+    jobOffset = 0;
+    jobTail = (jobTail + 1) % EEPROM_QUEUE_JOBS;
+    jobCount--;
+  }
+  drained = true;
+}
+
+static inline uint8_t readEepromByte(uint16_t addr) { return EEPROM.read(addr); }
+#endif
+
+// Queue a write. Returns immediately unless the ring is full, in which case
+// it waits for the interrupt to drain enough room.
+void eepromQueueWrite(int addr, const void *data, uint8_t len) {
+  const uint8_t *src = (const uint8_t *)data;
+  trace(TRACE_EEPROM_WRITE, len, addr);
+
+  while (len > 0) {
+    uint8_t chunk = min(len, EEPROM_QUEUE_BYTES);
+    while (jobCount >= EEPROM_QUEUE_JOBS ||
+           EEPROM_QUEUE_BYTES - dataCount < chunk) {
+      // Saturated: the ready interrupt frees space as it goes
+    }
+
+    for (uint8_t i = 0; i < chunk; i++) {
+      dataRing[(dataHead + i) % EEPROM_QUEUE_BYTES] = src[i];
+    }
+    dataHead = (dataHead + chunk) % EEPROM_QUEUE_BYTES;
+
+    noInterrupts();
+    jobs[jobHead].addr = addr;
+    jobs[jobHead].len = chunk;
+    jobHead = (jobHead + 1) % EEPROM_QUEUE_JOBS;
+    jobCount++;
+    dataCount += chunk;
+    drained = false;
+    interrupts();
+    kickQueue();
+
+    addr += chunk;
+    src += chunk;
+    len -= chunk;
+  }
+}
+
+// Latest queued value for addr, if a pending write covers it
+static bool pendingByte(uint16_t addr, uint8_t *value) {
+  bool found = false;
+  uint8_t index = dataTail;
+  uint8_t job = jobTail;
+
+  for (uint8_t n = 0; n < jobCount; n++) {
+    uint8_t offset = n == 0 ? jobOffset : 0;
+    uint8_t len = jobs[job].len;
+    for (; offset < len; offset++) {
+      if (jobs[job].addr + offset == addr) {
+        *value = dataRing[index]; // Later jobs override earlier ones
+        found = true;
+      }
+      index = (index + 1) % EEPROM_QUEUE_BYTES;
+    }
+    job = (job + 1) % EEPROM_QUEUE_JOBS;
+  }
+  return found;
+}
+
+// Read EEPROM as it will be once the queue drains. Queued bytes come from
+// the ring; only bytes that must come from the hardware wait, and then at
+// most once, for the byte in flight. The ready interrupt is held off
+// meanwhile so no new write starts under the read.
+void eepromRead(int addr, void *data, uint8_t len) {
+  uint8_t *dst = (uint8_t *)data;
+#if defined(__AVR__)
+  noInterrupts();
+  bool draining = EECR & _BV(EERIE);
+  EECR &= ~_BV(EERIE);
+  interrupts();
+  bool settled = false;
+#endif
+
+  for (uint8_t i = 0; i < len; i++) {
+    uint16_t at = addr + i;
+    uint8_t value;
+#if defined(__AVR__)
+    if (!pendingByte(at, &value)) {
+      if (verifyPending && verifyAddr == at) {
+        value = verifyValue; // Being written right now
+      } else {
+        while (!settled && (EECR & _BV(EEPE))) {
+        }
+        settled = true;
+        value = readEepromByte(at);
+      }
+    }
+#else
+    noInterrupts();
+    if (!pendingByte(at, &value)) {
+      value = readEepromByte(at);
+    }
+    interrupts();
+#endif
+    dst[i] = value;
+  }
+
+#if defined(__AVR__)
+  if (draining) {
+    kickQueue();
+  }
+#endif
+}
+
+bool eepromQueueIdle() { return jobCount == 0 && drained; }
+
+void eepromQueueFlush() {
+  while (!eepromQueueIdle()) {
+  }
+}
+
+// Read the bytes the EEPROM actually holds, once every queued write is done.
+// Unlike eepromRead() this shows a failed or torn write as it is.
+void eepromReadStored(int addr, void *data, uint8_t len) {
+  uint8_t *dst = (uint8_t *)data;
+
+  eepromQueueFlush();
+  for (uint8_t i = 0; i < len; i++) {
+    dst[i] = readEepromByte(addr + i);
+  }
+}
+
+// Report the outcome once everything queued so far has been written
+void eepromQueueService() {
+  if (!drained || jobCount > 0 || (bytesWritten == 0 && bytesSkipped == 0)) {
+    return;
+  }
+
+  EepromReport report;
+  noInterrupts();
+  report.status = failed ? EEPROM_STATUS_FAILED : EEPROM_STATUS_OK;
+  report.failAddr = failAddr;
+  report.written = bytesWritten;
+  report.skipped = bytesSkipped;
+  failed = false;
+  bytesWritten = 0;
+  bytesSkipped = 0;
+  interrupts();
+
+  trace(TRACE_EEPROM_DONE, report.status, report.written);
+  if (programmingMode) {
+    sendReport(REPORT_EEPROM, (const uint8_t *)&report, sizeof(report));
+  }
+}
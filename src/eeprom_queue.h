@@ -0,0 +1,47 @@
+#ifndef EEPROM_QUEUE_H
+#define EEPROM_QUEUE_H
+
+#include <Arduino.h>
+
+// Write-behind EEPROM queue. Writes are copied into a RAM ring and drained
+// one byte at a time by the EEPROM-ready interrupt, so foreground callers
+// return immediately instead of waiting ~3.3ms per byte. Unchanged bytes are
+// skipped and every written byte is read back and verified.
+// Sized for the largest single transaction, a program sync commit (marker,
+// five records, config, marker clear: 95 bytes in 8 writes), so it queues
+// without waiting once the staged shadows have drained.
+const uint8_t EEPROM_QUEUE_JOBS = 10;  // Pending write requests
+const uint8_t EEPROM_QUEUE_BYTES = 96; // Pending data bytes
+
+// Completion status reported to the host (REPORT_EEPROM payload)
+enum EepromStatus {
+  EEPROM_STATUS_OK = 0,    // All queued bytes written and verified
+  EEPROM_STATUS_FAILED = 1 // A byte read back differently (see failAddr)
+};
+
+struct EepromReport {
+  uint16_t failAddr; // First address that failed verification
+  uint16_t written;  // Bytes actually written
+  uint16_t skipped;  // Bytes skipped because they were unchanged
+  uint8_t status;    // EepromStatus
+};
+
+// Function declarations
+void eepromQueueWrite(int addr, const void *data, uint8_t len);
+void eepromRead(int addr, void *data, uint8_t len);
+void eepromReadStored(int addr, void *data, uint8_t len); // Drain, read back
+bool eepromQueueIdle();
+void eepromQueueFlush();   // Wait until every queued byte is written
+void eepromQueueService(); // Report completion from the main loop
+
+// Typed helpers mirroring EEPROM.put/EEPROM.get
+template <typename T> void eepromPut(int addr, const T &value) {
+  eepromQueueWrite(addr, &value, sizeof(T));
+}
+
+template <typename T> T &eepromGet(int addr, T &value) {
+  eepromRead(addr, &value, sizeof(T));
+  return value;
+}
+
+#endif // EEPROM_QUEUE_H
@@ -0,0 +1,182 @@
+#include "homing.h"
+#include "command_processor.h"
+#include "menu_system.h"
+#include "motor_control.h"
+
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+#endif
+
+volatile bool limitArmed = false;
+volatile bool limitHit = false;
+
+static bool homed = false; // A homing succeeded since boot
+static int32_t lastOffset = 0;
+static uint32_t lastDurationMs = 0;
+
+// Velocity ramp for the fast phases, fed to the motion queue
+static struct {
+  long remaining;    // Microsteps left to plan
+  uint32_t velocity; // Current microsteps/s
+  uint32_t target;   // Cruise microsteps/s
+  uint16_t accel;    // Microsteps/s^2
+  bool positive;
+} ramp;
+
+#if !defined(__AVR__)
+static void limitInterrupt() { homingPinChange(); }
+#endif
+
+void setupHoming() {
+  pinMode(LIMIT_PIN, INPUT_PULLUP);
+#if defined(__AVR__)
+  // Shares PCINT0 with the button; the handler lives in power_manager.cpp
+  *digitalPinToPCMSK(LIMIT_PIN) |= _BV(digitalPinToPCMSKbit(LIMIT_PIN));
+  *digitalPinToPCICR(LIMIT_PIN) |= _BV(digitalPinToPCICRbit(LIMIT_PIN));
+#else
+  attachInterrupt(digitalPinToInterrupt(LIMIT_PIN), limitInterrupt, FALLING);
+#endif
+}
+
+static bool switchClosed() { return digitalRead(LIMIT_PIN) == LOW; }
+
+static void armLimit(bool armed) {
+  limitHit = false;
+  limitArmed = armed;
+}
+
+// MotionPlanner: accelerate in HOMING_RAMP_TICK_MS slices, then cruise
+static bool planRamp() {
+  if (ramp.remaining <= 0) {
+    return false;
+  }
+
+  uint32_t velocity = ramp.velocity;
+  long steps = ramp.remaining;
+  if (velocity < ramp.target) {
+    steps = max(1L, (long)(velocity * HOMING_RAMP_TICK_MS / 1000));
+    ramp.velocity = min(ramp.target,
+                        velocity + (uint32_t)ramp.accel * HOMING_RAMP_TICK_MS /
+                                       1000);
+  }
+  steps = min(steps, ramp.remaining);
+  ramp.remaining -= steps;
+
+  queueSegment(ramp.positive ? steps : -steps, 1000000UL / velocity);
+  return true;
+}
+
+// Ramp from the latch velocity (a safe start speed) up to the seek velocity
+static void rampMove(long distance, bool positive, const HomingConfig &cfg) {
+  ramp.remaining = distance;
+  ramp.velocity = cfg.latchVelocity;
+  ramp.target = max(cfg.seekVelocity, cfg.latchVelocity);
+  ramp.accel = cfg.accel ? cfg.accel : 1;
+  ramp.positive = positive;
+  runMotionQueue(planRamp);
+}
+
+// Stopped or paused by the user; either ends the homing run
+static bool homingInterrupted() { return !programRunning || programPaused; }
+
+static uint8_t homingPhases(const HomingConfig &cfg) {
+  bool toward = cfg.flags & HOMING_FLAG_POSITIVE;
+
+  // Fast seek; skipped when already sitting on the switch
+  if (!switchClosed()) {
+    armLimit(true);
+    rampMove(HOMING_MAX_TRAVEL, toward, cfg);
+    if (!limitHit) {
+      return homingInterrupted() ? HOMING_ABORTED : HOMING_NOT_FOUND;
+    }
+  }
+
+  // Back off far enough that the switch opens again
+  armLimit(false);
+  rampMove(cfg.backoff, !toward, cfg);
+  if (homingInterrupted()) {
+    return HOMING_ABORTED;
+  }
+  if (switchClosed()) {
+    return HOMING_STUCK;
+  }
+
+  // Slow re-approach; the interrupt halts the run at the switch edge
+  armLimit(true);
+  runMicrosteps(2L * cfg.backoff + DEFAULT_MICROSTEPPING, toward,
+                1000000UL / cfg.latchVelocity);
+  if (!limitHit) {
+    return homingInterrupted() ? HOMING_ABORTED : HOMING_NOT_FOUND;
+  }
+  return HOMING_OK;
+}
+
+uint8_t runHoming() {
+  HomingConfig cfg;
+  loadHomingConfig(&cfg);
+
+  uint32_t start = millis();
+  programRunning = true;
+  programPaused = false;
+  setMotionStopFlag(&limitHit);
+
+  uint8_t status = homingPhases(cfg);
+
+  setMotionStopFlag(nullptr);
+  armLimit(false);
+  lastDurationMs = millis() - start;
+
+  // A pause cannot be resumed into homing: end it as a stop would
+  if (programPaused) {
+    programRunning = false;
+    programPaused = false;
+    if (inPauseMenu) {
+      exitPauseMenu();
+    }
+  }
+
+  if (status == HOMING_OK) {
+    // Where the previous zero put the switch: the repeatability error
+    lastOffset = positionMicrosteps();
+    setPositionMicrosteps(0);
+  }
+  return status;
+}
+
+static void sendHomingReport(uint8_t status, bool first) {
+  HomingReport report;
+  report.status = status;
+  report.flags = first ? HOMING_REPORT_FIRST : 0;
+  report.offset = status == HOMING_OK ? lastOffset : 0;
+  report.durationMs = lastDurationMs;
+  loadHomingConfig(&report.config);
+  sendReport(REPORT_HOMING, (const uint8_t *)&report, sizeof(report));
+}
+
+void handleHomingCommand(const char *data, int dataLen) {
+  if (dataLen < 1) {
+    return;
+  }
+
+  switch (data[0]) {
+  case HOMING_RUN: {
+    bool first = !homed;
+    uint8_t status = runHoming();
+    if (status == HOMING_OK) {
+      homed = true;
+    }
+    sendHomingReport(status, first);
+    break;
+  }
+  case HOMING_CONFIGURE: {
+    HomingConfig cfg;
+    memcpy(&cfg, data + 1, offsetof(HomingConfig, magic));
+    saveHomingConfig(cfg);
+    sendHomingReport(HOMING_SETTINGS, !homed);
+    break;
+  }
+  case HOMING_QUERY:
+    sendHomingReport(HOMING_SETTINGS, !homed);
+    break;
+  }
+}
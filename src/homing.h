@@ -0,0 +1,59 @@
+#ifndef HOMING_H
+#define HOMING_H
+
+#include <Arduino.h>
+
+#include "config_manager.h"
+
+// Limit-switch homing. A fast seek with an acceleration ramp finds the
+// switch, the carriage backs off, and a slow re-approach latches the switch
+// edge: the pin-change interrupt halts the step engine before the next
+// microstep, so the zero lands on the exact microstep where the switch
+// closed. The switch connects the pin to GND (internal pull-up).
+const int LIMIT_PIN = 10;               // PB6 / PCINT6
+const long HOMING_MAX_TRAVEL = 200000L; // Give up after this many microsteps
+const uint8_t HOMING_RAMP_TICK_MS = 10; // Velocity step of the seek ramp
+
+// Homing sub-commands (CMD_HOMING)
+enum HomingCommand {
+  HOMING_RUN = 0,       // Home now
+  HOMING_CONFIGURE = 1, // seek(2), latch(2), accel(2), backoff(2), flags(1)
+  HOMING_QUERY = 2      // Report the current settings
+};
+
+// Homing result (REPORT_HOMING status)
+enum HomingStatus {
+  HOMING_OK = 0,
+  HOMING_NOT_FOUND = 1, // Switch not reached within HOMING_MAX_TRAVEL
+  HOMING_STUCK = 2,     // Switch still closed after backing off
+  HOMING_ABORTED = 3,   // Stopped or paused by the user
+  HOMING_SETTINGS = 4   // No homing run; settings only
+};
+
+const uint8_t HOMING_REPORT_FIRST = 0x01; // No earlier homing since boot
+
+struct HomingReport {
+  uint8_t status;      // HomingStatus
+  uint8_t flags;       // HOMING_REPORT_*
+  int32_t offset;      // Latch position against the previous zero, microsteps
+  uint32_t durationMs; // Time the whole homing took
+  HomingConfig config; // Settings in use
+};
+
+// Set by the pin-change interrupt while a homing phase is armed
+extern volatile bool limitArmed;
+extern volatile bool limitHit;
+
+// Called from the PCINT0 interrupt
+inline void homingPinChange() {
+  if (limitArmed && digitalRead(LIMIT_PIN) == LOW) {
+    limitHit = true;
+  }
+}
+
+// Function declarations
+void setupHoming();
+uint8_t runHoming(); // Blocking; returns a HomingStatus
+void handleHomingCommand(const char *data, int dataLen);
+
+#endif // HOMING_H
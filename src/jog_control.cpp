@@ -0,0 +1,74 @@
+#include "jog_control.h"
+#include "config_manager.h"
+#include "motor_control.h"
+
+// Velocities are kept in Q8 (microsteps/s x 256) so slow ramps still move
+static int32_t targetQ8 = 0;
+static int32_t velocityQ8 = 0;
+static uint16_t accelLimit = JOG_DEFAULT_ACCEL;
+static bool active = false;
+
+static uint32_t lastSetpointMs = 0;
+static uint32_t lastServiceUs = 0;
+static uint32_t lastStepUs = 0;
+
+void setJogVelocity(int16_t velocity, uint16_t accel) {
+  velocity = constrain(velocity, -JOG_MAX_VELOCITY, JOG_MAX_VELOCITY);
+  targetQ8 = (int32_t)velocity * 256;
+  accelLimit = accel ? accel : JOG_DEFAULT_ACCEL;
+  lastSetpointMs = millis();
+
+  if (!active && velocity != 0) {
+    active = true;
+    lastServiceUs = lastStepUs = micros();
+  }
+}
+
+void jogService() {
+  if (!active) {
+    return;
+  }
+
+  // Deadman: no fresh setpoint, ramp down to a stop
+  if (millis() - lastSetpointMs > JOG_DEADMAN_MS) {
+    targetQ8 = 0;
+  }
+
+  // Slew toward the target under the acceleration limit
+  uint32_t now = micros();
+  uint32_t dtUs = min(now - lastServiceUs, (uint32_t)50000);
+  lastServiceUs = now;
+  int32_t maxDelta = (uint32_t)accelLimit * dtUs / 3906; // 1e6 / 256
+  int32_t error = targetQ8 - velocityQ8;
+  velocityQ8 += constrain(error, -maxDelta, maxDelta);
+
+  int32_t speedQ8 = velocityQ8 < 0 ? -velocityQ8 : velocityQ8;
+  if (speedQ8 < 256) {
+    // Below one microstep per second: stopped
+    if (targetQ8 == 0) {
+      velocityQ8 = 0;
+      active = false;
+    }
+    lastStepUs = now;
+    return;
+  }
+
+  // Emit a step once the period for the current velocity has elapsed
+  uint32_t periodUs = 256000000UL / speedQ8;
+  uint32_t elapsed = now - lastStepUs;
+  if (elapsed >= periodUs) {
+    bool direction = velocityQ8 > 0;
+    pulseStep(direction);
+    // Keep the cadence, but never burst to catch up after a stall
+    lastStepUs = elapsed >= 2 * periodUs ? now : lastStepUs + periodUs;
+  }
+}
+
+bool jogActive() { return active; }
+
+void jogHalt() {
+  targetQ8 = velocityQ8 = 0;
+  active = false;
+}
+
+int16_t jogVelocity() { return velocityQ8 / 256; }
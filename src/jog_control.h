@@ -0,0 +1,23 @@
+#ifndef JOG_CONTROL_H
+#define JOG_CONTROL_H
+
+#include <Arduino.h>
+
+// Streaming velocity (jog) mode. The host streams signed velocity setpoints
+// at 20-100 Hz; the firmware slews toward each one under an acceleration
+// limit and ramps to a stop on its own if setpoints stop arriving.
+const uint16_t JOG_DEADMAN_MS = 250;       // Setpoint timeout before ramp-down
+const uint16_t JOG_DEFAULT_ACCEL = 8000;   // Microsteps/s^2 if none given
+// Steps come from loop() passes, one per pass at most. A pass that reads a
+// setpoint or polls the driver takes a few hundred microseconds, so a higher
+// rate would be dropped to whatever the passes allow and the motor stutter.
+const int16_t JOG_MAX_VELOCITY = 4000;     // Microsteps/s
+
+// Function declarations
+void setJogVelocity(int16_t velocity, uint16_t accel); // Microsteps/s
+void jogService();  // Call every loop() pass; emits due steps
+bool jogActive();   // Moving or still slewing
+void jogHalt();     // Stop immediately (no ramp)
+int16_t jogVelocity(); // Current (slewed) velocity, microsteps/s
+
+#endif // JOG_CONTROL_H
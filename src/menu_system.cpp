@@ -1,7 +1,9 @@
 #include "menu_system.h"
 #include "config_manager.h"
 #include "display_manager.h"
+#include "trace.h"
 
+#if FEATURE_MENU
 // Button pin definition
 const int buttonPin = 9;
 
@@ -87,6 +89,9 @@ void checkButton() {
   lastButtonState = reading;
 }
 
+// True while an edge is being debounced or the button is held
+bool buttonBusy() { return lastButtonState != buttonState || buttonPressed; }
+
 // Build menu items based on stored programs
 void buildMenuItems() {
   menuItemCount = 0;
@@ -100,6 +105,19 @@ void buildMenuItems() {
     menuItemCount++;
   }
 
+  // Add stored playlists
+  for (int i = 0; i < MAX_PLAYLISTS && menuItemCount < MAX_MENU_ITEMS - 1;
+       i++) {
+    Playlist playlist;
+    if (!loadPlaylist(i, &playlist)) {
+      continue;
+    }
+    strcpy(menuItems[menuItemCount].name, playlist.name);
+    menuItems[menuItemCount].type = 3;
+    menuItems[menuItemCount].id = i;
+    menuItemCount++;
+  }
+
   // Add settings/info item
   strcpy(menuItems[menuItemCount].name, "INFO");
   menuItems[menuItemCount].type = 2;
@@ -117,6 +135,7 @@ void enterMenuMode() {
   inMenuMode = true;
   currentMenuIndex = 0;
   buildMenuItems();
+  trace(TRACE_MENU_ENTER, 0, menuItemCount);
   displayMessage(F("MENU"), 200);
   updateDisplay();
 }
@@ -124,6 +143,7 @@ void enterMenuMode() {
 // Exit menu mode
 void exitMenuMode() {
   inMenuMode = false;
+  trace(TRACE_MENU_EXIT);
   updateDisplay();
 }
 
@@ -146,6 +166,7 @@ void selectMenuItem() {
 
   switch (selectedItem.type) {
   case 0: // Program
+  case 3: // Playlist
     exitMenuMode();
     displayMessage(F("RUN"), 200);
     programRunning = true;
@@ -153,15 +174,7 @@ void selectMenuItem() {
     break;
 
   case 2: // Info
-    display.clearDisplay();
-    display.setTextSize(1);
-    display.setTextColor(SSD1306_WHITE);
-
-    display.setCursor(0, 0);
-    display.print(F("POS:"));
-    display.print(currentPosition);
-
-    display.display();
+    displayInfo();
     delay(1500);
     enterMenuMode();
     break;
@@ -173,6 +186,7 @@ void enterPauseMenu() {
   inPauseMenu = true;
   pauseMenuIndex = 0;
   programPaused = true;
+  trace(TRACE_PAUSE, 0, currentPosition);
   displayMessage(F("PAUSE"), 200);
   updateDisplay();
 }
@@ -194,6 +208,7 @@ void selectPauseMenuItem() {
   switch (pauseMenuIndex) {
   case 0:
     programPaused = false;
+    trace(TRACE_RESUME, 0, currentPosition);
     displayMessage(F("RESUME"), 200);
     exitPauseMenu();
     break;
@@ -207,3 +222,4 @@ void selectPauseMenuItem() {
     break;
   }
 }
+#endif // FEATURE_MENU
@@ -3,6 +3,8 @@
 
 #include <Arduino.h>
 
+#include "build_profile.h"
+
 // Menu system constants
 const int MAX_MENU_ITEMS = 12;
 const unsigned long DEBOUNCE_DELAY = 50;
@@ -12,19 +14,21 @@ const unsigned long SHORT_PRESS_THRESHOLD = 50;   // Minimum press time
 // Menu item structure
 struct MenuItem {
   char name[9];  // 8 characters + null terminator
-  int type; // 0=program, 1=cycle, 2=settings
-  int id;   // program ID or setting ID
+  int type; // 0=program, 1=cycle, 2=settings, 3=playlist
+  int id;   // program, playlist or setting ID
 };
 
 // External variables (defined in main sketch)
+extern bool programRunning;
+extern bool programPaused;
+
+#if FEATURE_MENU
 extern MenuItem menuItems[MAX_MENU_ITEMS];
 extern int menuItemCount;
 extern int currentMenuIndex;
 extern bool inMenuMode;
 extern bool inPauseMenu;
 extern int pauseMenuIndex;
-extern bool programRunning;
-extern bool programPaused;
 
 // Button control variables
 extern const int buttonPin;
@@ -38,6 +42,7 @@ extern bool longPressDetected;
 // Function declarations
 void setupButton();
 void checkButton();
+bool buttonBusy(); // Debounce or press in progress, keep polling
 void buildMenuItems();
 void enterMenuMode();
 void exitMenuMode();
@@ -47,5 +52,17 @@ void enterPauseMenu();
 void exitPauseMenu();
 void navigatePauseMenu();
 void selectPauseMenuItem();
+#else
+// No button: programs are started over USB only
+const bool inMenuMode = false;
+const bool inPauseMenu = false;
+inline void setupButton() {}
+inline void checkButton() {}
+inline bool buttonBusy() { return false; }
+inline void buildMenuItems() {}
+inline void enterMenuMode() {}
+inline void exitMenuMode() {}
+inline void exitPauseMenu() {}
+#endif
 
 #endif // MENU_SYSTEM_H
@@ -2,6 +2,11 @@
 #include "config_manager.h"
 #include "display_manager.h"
 #include "menu_system.h"
+#include "power_manager.h"
+#include "sequencer.h"
+#include "sync_line.h"
+#include "tmc_driver.h"
+#include "trace.h"
 
 // External variables (defined in main sketch)
 extern long currentPosition;
@@ -52,125 +57,448 @@ void setupMotorPins() {
   pinMode(DIR_PIN, OUTPUT);
   pinMode(MS1_PIN, OUTPUT);
   pinMode(MS2_PIN, OUTPUT);
-  // pinMode(MS3_PIN, OUTPUT);
+  setMicrostepping(DEFAULT_MICROSTEPPING);
 }
 
-// Set microstepping mode using MS pins
+// Set the microstep resolution. In UART mode the driver takes it from
+// CHOPCONF and MS1/MS2 only strap its address; in standalone mode the
+// TMC2209 reads MS2,MS1 = LL 1/8, HH 1/16 (also LH 1/32, HL 1/64), so
+// coarser modes fall back to 1/8. Either way it interpolates to 1/256.
 void setMicrostepping(uint8_t mode) {
-  // TODO: TMC2209 1/16 step
-  digitalWrite(MS1_PIN, LOW);
-  digitalWrite(MS2_PIN, LOW);
-  // switch (mode)
-  // {
-  // case FULL_STEP: // Full step: L,L,L
-  //   digitalWrite(MS1_PIN, LOW);
-  //   digitalWrite(MS2_PIN, LOW);
-  //   digitalWrite(MS3_PIN, LOW);
-  //   break;
-  // case HALF_STEP: // Half step: H,L,L
-  //   digitalWrite(MS1_PIN, HIGH);
-  //   digitalWrite(MS2_PIN, LOW);
-  //   digitalWrite(MS3_PIN, LOW);
-  //   break;
-  // case QUARTER_STEP: // Quarter step: L,H,L
-  //   digitalWrite(MS1_PIN, LOW);
-  //   digitalWrite(MS2_PIN, HIGH);
-  //   digitalWrite(MS3_PIN, LOW);
-  //   break;
-  // case EIGHTH_STEP: // Eighth step: H,H,L
-  //   digitalWrite(MS1_PIN, HIGH);
-  //   digitalWrite(MS2_PIN, HIGH);
-  //   digitalWrite(MS3_PIN, LOW);
-  //   break;
-  // case SIXTEENTH_STEP: // Sixteenth step: H,H,H
-  //   digitalWrite(MS1_PIN, HIGH);
-  //   digitalWrite(MS2_PIN, HIGH);
-  //   digitalWrite(MS3_PIN, HIGH);
-  //   break;
-  // default: // Default to full step for invalid values
-  //   digitalWrite(MS1_PIN, LOW);
-  //   digitalWrite(MS2_PIN, LOW);
-  //   digitalWrite(MS3_PIN, LOW);
-  //   break;
-  // }
+#if FEATURE_TMC2209
+  digitalWrite(MS1_PIN, TMC_ADDRESS & 0x01 ? HIGH : LOW);
+  digitalWrite(MS2_PIN, TMC_ADDRESS & 0x02 ? HIGH : LOW);
+  driverSetMicrostepping(mode);
+#else
+  uint8_t level = mode == SIXTEENTH_STEP ? HIGH : LOW;
+  digitalWrite(MS1_PIN, level);
+  digitalWrite(MS2_PIN, level);
+#endif
 }
 
 // Motor control functions
 
-// Move to position with specified speed (in milliseconds)
-void moveToPositionWithSpeed(long targetPosition, uint32_t speedMs) {
-  long stepsToMove = abs(targetPosition - currentPosition);
-  bool direction = targetPosition > currentPosition;
+// Step output gate and timing statistics for the step engine
+bool stepOutputEnabled = true;
+MotionStats motionStats;
+static uint32_t lastSentUs = 0; // When the last pulse actually went out
 
-  // Adjust for microstepping - need more pulses but faster timing to maintain
-  // same speed
-  long actualStepsToMove = stepsToMove * DEFAULT_MICROSTEPPING;
-  uint32_t adjustedSpeedMs = speedMs / DEFAULT_MICROSTEPPING;
+void setStepOutputEnabled(bool enabled) { stepOutputEnabled = enabled; }
 
-  digitalWrite(DIR_PIN, direction ? HIGH : LOW);
+void resetMotionStats() {
+  motionStats.steps = 0;
+  motionStats.elapsedUs = 0;
+  motionStats.slackUs = 0;
+  motionStats.minSlackUs = 0xFFFFFFFF;
+  motionStats.maxLateUs = 0;
+  motionStats.missed = 0;
+}
 
-  // Simplified acceleration (removed complex calculations to save space)
-  for (long i = 0; i < actualStepsToMove; i++) {
-    // Check for pause/stop request during movement
-    if (programPaused || !programRunning) {
-      currentPosition += direction ? (i / DEFAULT_MICROSTEPPING)
-                                   : -(i / DEFAULT_MICROSTEPPING);
-      return;
-    }
+// Convert a ms-per-step speed into the microstep pulse period. Matches the
+// original high/low yieldingDelay timing: two half periods of
+// speedMs / DEFAULT_MICROSTEPPING each.
+uint32_t microstepPeriodUs(uint32_t speedMs) {
+  uint32_t halfPeriodMs = speedMs / DEFAULT_MICROSTEPPING;
+  if (halfPeriodMs > MAX_HALF_PERIOD_MS) {
+    halfPeriodMs = MAX_HALF_PERIOD_MS;
+  }
+  return halfPeriodMs * 2000UL;
+}
+
+// Position in microsteps, the authority for every move. currentPosition
+// (full steps, rounded toward zero) follows it for the display, the menus
+// and the step-based commands.
+static long microstepPosition = 0;
+
+// Paused run waiting for resumePausedRun(): the unfinished segment is still
+// at the head of the queue, shortened to what is left of it, and the
+// planner keeps its place
+static bool runPaused = false;
+static long pausedAtMicrosteps = 0;
+
+// Account for one issued microstep
+static void countMicrostep(bool direction) {
+  microstepPosition += direction ? 1 : -1;
+  currentPosition = microstepPosition / DEFAULT_MICROSTEPPING;
+}
+
+long positionMicrosteps() { return microstepPosition; }
+
+// Redefine the current position (homing, set home). A paused run's resume
+// point moves with it, so it still names the same spot on the rail.
+void setPositionMicrosteps(long position) {
+  pausedAtMicrosteps += position - microstepPosition;
+  microstepPosition = position;
+  currentPosition = position / DEFAULT_MICROSTEPPING;
+}
 
+// Issue one microstep immediately (jog mode and other non-blocking callers).
+// Gated pulses do not move the carriage, so they are not counted.
+void pulseStep(bool direction) {
+  digitalWrite(DIR_PIN, direction ? HIGH : LOW);
+  if (stepOutputEnabled) {
     digitalWrite(STEP_PIN, HIGH);
-    yieldingDelay(adjustedSpeedMs);
     digitalWrite(STEP_PIN, LOW);
-    yieldingDelay(adjustedSpeedMs);
+    countMicrostep(direction);
+  }
+}
 
-    // Update display less frequently to reduce overhead
-    if (i % 10 == 0) {
-      updateDisplay(i / DEFAULT_MICROSTEPPING);
-    }
+// Shared timebase: deadline of the last pulse or dwell. Consecutive queued
+// segments continue from it, so a handover adds no dead time.
+static uint32_t lastPulseUs = 0;
+static uint32_t lastYieldUs = 0;
+
+// Optional external stop (e.g. a limit switch latched by an interrupt)
+static volatile bool *stopFlag = nullptr;
+
+void setMotionStopFlag(volatile bool *flag) { stopFlag = flag; }
+
+// Stopped, or halted by the external stop flag
+static bool motionAborted() {
+  return !programRunning || (stopFlag && *stopFlag);
+}
+
+// Paused, stopped, or halted by the external stop flag
+static bool motionInterrupted() { return programPaused || motionAborted(); }
+
+// Velocity of a run at this microstep period, in 1/256 microsteps/s. Period
+// 0 (as fast as the loop goes) counts as the engine's top rate of ~20kHz.
+static uint32_t runVelocity(uint32_t periodUs) {
+  const uint32_t FASTEST_PERIOD_US = 50;
+  return 256000000UL / max(periodUs, FASTEST_PERIOD_US);
+}
+
+// Velocity PAUSE_DECEL takes off over one pulse at this period, same units
+static uint32_t pauseSlowdown(uint32_t periodUs) {
+  return periodUs < 0x10000UL ? PAUSE_DECEL * periodUs / 3906 : 0xFFFFFFFFUL;
+}
+
+// One more pulse of deceleration would bring the run to rest
+static bool pauseCanStop(uint32_t periodUs) {
+  return pauseSlowdown(periodUs) >= runVelocity(periodUs);
+}
+
+// Stop before the next pulse at this period. A pause only stops pulses slow
+// enough to stop dead; faster ones are first slowed down by stepRun().
+static bool motionHalted(uint32_t periodUs) {
+  return motionAborted() || (programPaused && pauseCanStop(periodUs));
+}
+
+// Timebase origin requested for the next move (synchronized starts)
+static uint32_t pendingOriginUs = 0;
+static bool originPending = false;
+
+void setMotionOrigin(uint32_t originUs) {
+  pendingOriginUs = originUs;
+  originPending = true;
+}
+
+void clearMotionOrigin() { originPending = false; }
+
+// Timebase origin for a move starting now: the requested origin, waited
+// for if it is still ahead, or the current time
+static uint32_t takeMotionOrigin() {
+  if (!originPending) {
+    return micros();
+  }
+  originPending = false;
+  while ((int32_t)(micros() - pendingOriginUs) < 0 && !motionInterrupted()) {
+  }
+  return pendingOriginUs;
+}
+
+// Planned segments and the planner that keeps the queue topped up
+static MotionSegment motionQueue[MOTION_QUEUE_SIZE];
+static uint8_t queueHead = 0;
+static uint8_t queueTail = 0;
+static uint8_t queueCount = 0;
+static MotionPlanner motionPlanner = nullptr;
+
+// Queue a segment; false if the queue is full. Queueing a new move drops a
+// paused run.
+bool queueSegment(long steps, uint32_t periodUs) {
+  dropPausedRun();
+  if (queueCount >= MOTION_QUEUE_SIZE) {
+    return false;
   }
+  motionQueue[queueHead].steps = steps;
+  motionQueue[queueHead].periodUs = periodUs;
+  queueHead = (queueHead + 1) % MOTION_QUEUE_SIZE;
+  queueCount++;
+  return true;
+}
 
-  currentPosition = targetPosition;
+uint8_t motionQueueSpace() { return MOTION_QUEUE_SIZE - queueCount; }
+
+void clearMotionQueue() {
+  queueHead = queueTail = queueCount = 0;
 }
 
-// Run a loop program (infinite forward/backward motion)
-void runLoopProgram(uint8_t programId) {
-  LoopProgram loopProg;
-  if (!loadLoopProgram(programId, &loopProg)) {
-    Serial.println("ERROR: Failed to load loop program");
-    return; // Failed to load loop program
+// Let the planner add one segment while the current one is still running
+static void refillMotionQueue() {
+  if (motionPlanner && queueCount < MOTION_QUEUE_SIZE && !motionPlanner()) {
+    motionPlanner = nullptr; // Sequence fully planned
   }
+}
 
-  // Run infinite cycles until stopped or paused
-  while (programRunning && !programPaused) {
-    // Forward movement
-    long targetPosition = currentPosition + loopProg.steps;
-    moveToPositionWithSpeed(targetPosition, loopProg.delayMs);
+// Work done between pulses: button, display refresh, queue refill, sync
+static void motionHousekeeping() {
+  const uint32_t YIELD_INTERVAL_US = 10000; // Button check every 10ms
+
+  if (micros() - lastYieldUs >= YIELD_INTERVAL_US) {
+    lastYieldUs = micros();
+    if (yieldCallback)
+      yieldCallback();
+  }
+  if (millis() - lastDisplayUpdate > DISPLAY_UPDATE_INTERVAL) {
+    updateDisplay();
+    lastDisplayUpdate = millis();
+  }
+  refillMotionQueue();
+  lastPulseUs += syncTimebaseCorrection();
+}
+
+// Wait until periodUs after the last deadline, still yielding on long waits.
+// Far from the deadline the CPU sleeps; the millis() tick wakes it within
+// ~1ms. Returns the time since the last deadline, or 0 if paused/stopped.
+static uint32_t waitForDeadline(uint32_t periodUs) {
+  const uint32_t YIELD_INTERVAL_US = 10000;
+  const uint32_t SLEEP_MARGIN_US = 2500; // Stay awake this close to a pulse
+  uint32_t elapsed;
+
+  while ((elapsed = micros() - lastPulseUs) < periodUs) {
+    if (periodUs - elapsed > SLEEP_MARGIN_US) {
+      idleSleep();
+    }
+    if (micros() - lastYieldUs >= YIELD_INTERVAL_US) {
+      lastYieldUs = micros();
+      if (yieldCallback)
+        yieldCallback();
+      refillMotionQueue();
+      lastPulseUs += syncTimebaseCorrection();
+    }
+    if (motionHalted(periodUs)) {
+      return 0;
+    }
+  }
+  return elapsed;
+}
 
-    // Check if we should stop/pause after forward movement
-    if (!programRunning || programPaused) {
+// Issue microsteps against the shared timebase. Pulses are scheduled on a
+// running deadline so housekeeping time does not accumulate as drift. On a
+// pause a fast run decelerates along its path before stopping, so no
+// microstep is lost and the carriage does not jolt.
+// Returns the number of pulses issued (fewer than count if paused/stopped).
+static long stepRun(long count, bool direction, uint32_t periodUs) {
+  digitalWrite(DIR_PIN, direction ? HIGH : LOW);
+
+  uint32_t velocity = runVelocity(periodUs); // Tracked while pausing
+  long i;
+
+  for (i = 0; i < count; i++) {
+    // Pause: lose PAUSE_DECEL * period of velocity per pulse, as v - a * t
+    if (programPaused && !pauseCanStop(periodUs)) {
+      uint32_t slowdown = pauseSlowdown(periodUs);
+      velocity = velocity > slowdown ? velocity - slowdown : 1;
+      periodUs = 256000000UL / velocity;
+    }
+    if (motionHalted(periodUs)) {
       break;
     }
 
-    // Brief pause at end of forward movement with yielding
-    yieldingDelay(100);
+    motionHousekeeping();
 
-    // Backward movement
-    targetPosition = currentPosition - loopProg.steps;
-    moveToPositionWithSpeed(targetPosition, loopProg.delayMs);
+    // Idle time left before this pulse is due
+    uint32_t elapsed = micros() - lastPulseUs;
+    uint32_t slack = elapsed < periodUs ? periodUs - elapsed : 0;
+    motionStats.slackUs += slack;
+    if (slack < motionStats.minSlackUs) {
+      motionStats.minSlackUs = slack;
+    }
 
-    // Check if we should stop/pause after backward movement
-    if (!programRunning || programPaused) {
+    elapsed = waitForDeadline(periodUs);
+    if (motionHalted(periodUs)) {
       break;
     }
 
-    // Brief pause at end of backward movement with yielding
-    yieldingDelay(100);
+    if (stepOutputEnabled) {
+      digitalWrite(STEP_PIN, HIGH);
+      digitalWrite(STEP_PIN, LOW);
+      countMicrostep(direction);
+    }
+    uint32_t sentUs = micros();
+    if (motionStats.steps > 0 || i > 0) {
+      motionStats.elapsedUs += sentUs - lastSentUs;
+    }
+    lastSentUs = sentUs;
+
+    // Advance the deadline; resync instead of bursting if a full period late
+    uint32_t late = periodUs > 0 ? elapsed - periodUs : 0;
+    if (late > motionStats.maxLateUs) {
+      motionStats.maxLateUs = late;
+    }
+    if (late >= periodUs && periodUs > 0) {
+      motionStats.missed++;
+      lastPulseUs = micros();
+    } else {
+      lastPulseUs += periodUs;
+    }
+  }
+
+  motionStats.steps += i;
+  return i;
+}
+
+// Record how a move ended
+static void traceMoveEnd() {
+  uint8_t reason = !programRunning          ? TRACE_END_STOPPED
+                   : programPaused           ? TRACE_END_PAUSED
+                   : (stopFlag && *stopFlag) ? TRACE_END_HALTED
+                                             : TRACE_END_DONE;
+  trace(TRACE_MOVE_END, reason, currentPosition);
+}
+
+// Issue a run of microsteps at a fixed period, starting from now.
+// Returns the number of pulses issued (fewer than count if paused/stopped).
+long runMicrosteps(long count, bool direction, uint32_t periodUs) {
+  trace(TRACE_MOVE_START, TRACE_MOVE_RUN, currentPosition);
+  lastPulseUs = takeMotionOrigin();
+  lastYieldUs = micros();
+  long done = stepRun(count, direction, periodUs);
+  traceMoveEnd();
+  return done;
+}
+
+// Paused, and neither stopped nor halted: the run can be resumed
+static bool pauseHolds() {
+  return programRunning && programPaused && !(stopFlag && *stopFlag);
+}
+
+// Run the queue on the current timebase until the plan is exhausted or the
+// run is paused/stopped. The segment in progress stays at the head of the
+// queue and is shortened as it runs. A resumable run that is paused keeps
+// the queue and the planner; otherwise both are dropped. Returns true if
+// the plan ran to the end.
+static bool runSegments(bool resumable) {
+  while (!motionInterrupted()) {
+    while (motionPlanner && queueCount == 0) {
+      refillMotionQueue();
+    }
+    if (queueCount == 0) {
+      break;
+    }
+
+    MotionSegment &segment = motionQueue[queueTail];
+    if (segment.steps == 0) {
+      // Dwell: hold position until the timebase reaches the end
+      waitForDeadline(segment.periodUs);
+      if (motionInterrupted()) {
+        segment.periodUs -= min(micros() - lastPulseUs, segment.periodUs);
+        break;
+      }
+      lastPulseUs += segment.periodUs;
+    } else {
+      long count = abs(segment.steps);
+      long done = stepRun(count, segment.steps > 0, segment.periodUs);
+      if (done < count) {
+        segment.steps += segment.steps > 0 ? -done : done;
+        break;
+      }
+    }
+    queueTail = (queueTail + 1) % MOTION_QUEUE_SIZE;
+    queueCount--;
   }
 
+  bool finished = queueCount == 0 && !motionPlanner;
+  if (resumable && !finished && pauseHolds()) {
+    runPaused = true;
+    pausedAtMicrosteps = positionMicrosteps();
+  } else {
+    motionPlanner = nullptr;
+    clearMotionQueue();
+  }
+  traceMoveEnd();
+  return finished;
+}
+
+// Run queued segments back to back on one timebase, asking the planner for
+// more while each segment runs. Returns when the plan is exhausted or the
+// program is paused/stopped. A resumable run that is paused can be picked
+// up later by resumePausedRun(); otherwise what was still queued is dropped.
+void runMotionQueue(MotionPlanner planner, bool resumable) {
+  dropPausedRun();
+  trace(TRACE_MOVE_START, TRACE_MOVE_QUEUE, currentPosition);
+  motionPlanner = planner;
+  lastPulseUs = takeMotionOrigin();
+  lastYieldUs = micros();
+  runSegments(resumable);
+}
+
+bool motionPaused() { return runPaused; }
+
+void dropPausedRun() {
+  if (runPaused) {
+    runPaused = false;
+    motionPlanner = nullptr;
+    clearMotionQueue();
+  }
+}
+
+// Continue a paused run from exactly where it stopped: the rest of the
+// interrupted segment, then the queued segments and the planner. If the
+// carriage was jogged while paused it first returns to the pause point.
+void resumePausedRun() {
+  if (!runPaused) {
+    return;
+  }
+  trace(TRACE_MOVE_START, TRACE_MOVE_QUEUE, currentPosition);
+  lastPulseUs = micros();
+  lastYieldUs = lastPulseUs;
+
+  long offset = pausedAtMicrosteps - positionMicrosteps();
+  long count = abs(offset);
+  if (count > 0 &&
+      stepRun(count, offset > 0, RESUME_RETURN_PERIOD_US) < count) {
+    if (!pauseHolds()) {
+      dropPausedRun();
+    }
+    traceMoveEnd();
+    return;
+  }
+
+  runPaused = false;
+  if (runSegments(true)) {
+    programRunning = false;
+    displayMessage(F("Done"));
+  }
+}
+
+// Move to position with specified speed (in milliseconds)
+void moveToPositionWithSpeed(long targetPosition, uint32_t speedMs) {
+  // Position is counted per microstep as pulses go out, so an interrupted
+  // move leaves the position wherever the carriage actually is, and a
+  // paused move resumes with exactly the microsteps still to go
+  long delta = targetPosition * DEFAULT_MICROSTEPPING - positionMicrosteps();
+  if (delta != 0) {
+    queueSegment(delta, microstepPeriodUs(speedMs));
+  }
+  runMotionQueue(nullptr, true);
+}
+
+// Run a loop program (infinite forward/backward motion)
+void runLoopProgram(uint8_t programId) {
+  if (!startProgramSequence(programId)) {
+    TEXT_LOG(F("ERROR: Failed to load loop program"));
+    return; // Failed to load loop program
+  }
+
+  // Run infinite cycles until stopped or paused
+  runMotionQueue(planSequence, true);
+
   if (programPaused) {
-    Serial.println("Program paused");
+    TEXT_LOG(F("Program paused"));
   } else {
-    Serial.println("Program stopped");
+    TEXT_LOG(F("Program stopped"));
   }
 }
 
@@ -186,20 +514,25 @@ void executeStoredProgram() {
     // Run the selected program from menu, or first program if no menu selection
     int programToRun = 0;
 
-    // If we came from menu selection, use the selected program
+#if FEATURE_MENU
+    // If we came from menu selection, use the selected program or playlist
     if (menuItemCount > 0 && currentMenuIndex < menuItemCount) {
       MenuItem selectedItem = menuItems[currentMenuIndex];
       if (selectedItem.type == 0) { // It's a program
         programToRun = selectedItem.id;
+      } else if (selectedItem.type == 3) { // It's a playlist
+        runPlaylist(selectedItem.id);
+        return;
       }
     }
+#endif
 
     // Check program type and run appropriate function
     uint8_t programType = getProgramType(programToRun);
     if (programType == PROGRAM_TYPE_LOOP) {
       runLoopProgram(programToRun);
     } else {
-      Serial.println(F("ERROR: Invalid program type"));
+      TEXT_LOG(F("ERROR: Invalid program type"));
       return;
     }
   } else {
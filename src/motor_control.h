@@ -20,10 +20,46 @@ enum MicrostepMode {
   SIXTEENTH_STEP = 16
 };
 
+// Longest supported half period; keeps the microstep period within the
+// 32-bit micros() window (about 71 minutes)
+const uint32_t MAX_HALF_PERIOD_MS = 2000000UL;
+
+// Step engine timing statistics, accumulated by runMicrosteps()
+struct MotionStats {
+  uint32_t steps;      // Pulses issued (or skipped while gated)
+  uint32_t elapsedUs;  // First to last pulse, as actually issued
+  uint32_t slackUs;    // Sum of idle time left before each pulse
+  uint32_t minSlackUs; // Tightest idle margin before a pulse
+  uint32_t maxLateUs;  // Worst delay of a pulse past its deadline
+  uint32_t missed;     // Pulses more than a full period late
+};
+
+extern MotionStats motionStats;
+
+// A planned run of microsteps, or a dwell when steps == 0
+struct MotionSegment {
+  long steps;        // Signed microsteps (sign sets direction), 0 = dwell
+  uint32_t periodUs; // Microstep period, or the dwell length
+};
+
+const uint8_t MOTION_QUEUE_SIZE = 4;
+
+// A pause slows a run down along its path at this rate until one more
+// microstep would bring it to rest, then stops; a crawl stops at once
+const uint32_t PAUSE_DECEL = 8000; // Microsteps/s^2
+// Return to the pause point at this microstep period if jogged meanwhile
+const uint32_t RESUME_RETURN_PERIOD_US = 1000;
+
+// Planner callback: queue the next segment, return false when done
+typedef bool (*MotionPlanner)();
+extern bool stepOutputEnabled;
+
+#if FEATURE_MENU
 // External variables from menu system
 extern MenuItem menuItems[];
 extern int menuItemCount;
 extern int currentMenuIndex;
+#endif
 
 // Yield callback function pointer type
 typedef void (*YieldCallback)();
@@ -34,6 +70,23 @@ void setMicrostepping(uint8_t mode);
 void setYieldCallback(YieldCallback callback); // Set yield callback
 void yieldingDelay(
     uint32_t delayMs); // Non-blocking delay with callback yielding
+void setStepOutputEnabled(bool enabled); // Gate STEP pulses (dry run)
+void setMotionStopFlag(volatile bool *flag); // Halt moves when *flag is set
+void setPositionMicrosteps(long position);
+void setMotionOrigin(uint32_t originUs); // Timebase start of the next move
+void clearMotionOrigin();                // Drop an origin no move took
+void resetMotionStats();
+uint32_t microstepPeriodUs(uint32_t speedMs);
+long positionMicrosteps();       // Position including partial steps
+void pulseStep(bool direction); // Single microstep outside the step engine
+long runMicrosteps(long count, bool direction, uint32_t periodUs);
+bool queueSegment(long steps, uint32_t periodUs);
+uint8_t motionQueueSpace(); // Free queue slots
+void clearMotionQueue();
+void runMotionQueue(MotionPlanner planner, bool resumable = false);
+bool motionPaused();     // A paused run is waiting to be resumed
+void resumePausedRun();  // Continue it where it stopped (blocking)
+void dropPausedRun();    // Forget it
 void moveToPositionWithSpeed(long targetPosition, uint32_t speedMs);
 void runProgram(uint8_t programId);
 void runLoopProgram(uint8_t programId);
@@ -0,0 +1,58 @@
+#include "power_manager.h"
+#include "homing.h"
+#include "menu_system.h"
+#include "sync_line.h"
+
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+#include <avr/power.h>
+#include <avr/sleep.h>
+
+static volatile uint8_t wakeFlags = 0;
+
+// Button, limit switch or sync line edge: note it so loop() services the
+// button only when needed, let an armed homing phase latch the switch, and
+// timestamp sync pulses
+ISR(PCINT0_vect) {
+  wakeFlags |= WAKE_PIN_CHANGE;
+  homingPinChange();
+  syncPinChange();
+}
+
+void setupPower() {
+#if FEATURE_MENU
+  // Pin-change interrupt on the button so a press wakes the CPU
+  *digitalPinToPCMSK(buttonPin) |= _BV(digitalPinToPCMSKbit(buttonPin));
+  *digitalPinToPCICR(buttonPin) |= _BV(digitalPinToPCICRbit(buttonPin));
+#endif
+
+  // The ADC is never used
+  ADCSRA &= ~_BV(ADEN);
+  power_adc_disable();
+
+  set_sleep_mode(SLEEP_MODE_IDLE);
+}
+
+// Idle mode keeps timers, USB and pin-change interrupts running, so the
+// millis() tick bounds the wake latency to about 1ms
+void idleSleep() {
+  sleep_enable();
+  sleep_cpu();
+  sleep_disable();
+}
+
+uint8_t takeWakeFlags() {
+  noInterrupts();
+  uint8_t flags = wakeFlags;
+  wakeFlags = 0;
+  interrupts();
+  return flags;
+}
+#else
+void setupPower() {}
+
+void idleSleep() { yield(); }
+
+// No pin-change wake tracking: report the button as always worth a look
+uint8_t takeWakeFlags() { return WAKE_PIN_CHANGE; }
+#endif
@@ -0,0 +1,17 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+
+// Wake sources recorded by interrupts while the MCU sleeps. USB data and the
+// millis() timer also wake the CPU; they are polled directly by loop().
+enum WakeSource {
+  WAKE_PIN_CHANGE = 0x01 // Button (or other PCINT pin) changed state
+};
+
+// Function declarations
+void setupPower();       // Enable wake interrupts, power down unused blocks
+void idleSleep();        // Idle-mode sleep until the next interrupt
+uint8_t takeWakeFlags(); // Read and clear the recorded wake sources
+
+#endif // POWER_MANAGER_H
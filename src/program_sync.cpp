@@ -0,0 +1,211 @@
+#include "program_sync.h"
+#include "command_processor.h"
+#include "eeprom_queue.h"
+#include "menu_system.h"
+
+// Stored program record as laid out in a slot (live or shadow)
+struct ProgramRecord {
+  ProgramHeader header;
+  LoopProgram params;
+};
+
+// Transaction state
+static bool syncOpen = false;
+static uint8_t stagedMask = 0;
+
+// CRC-16/CCITT-FALSE, shared with the host (ui/script.js)
+static uint16_t crc16Update(uint16_t crc, uint8_t value) {
+  crc ^= (uint16_t)value << 8;
+  for (uint8_t bit = 0; bit < 8; bit++) {
+    crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+// Hash the canonical program bytes: name(8), steps(2), delayMs(4)
+static uint16_t recordHash(uint16_t crc, const ProgramRecord &record) {
+  for (uint8_t i = 0; i < 8; i++) {
+    crc = crc16Update(crc, record.header.name[i]);
+  }
+  crc = crc16Update(crc, record.params.steps & 0xFF);
+  crc = crc16Update(crc, record.params.steps >> 8);
+  for (uint8_t i = 0; i < 32; i += 8) {
+    crc = crc16Update(crc, (record.params.delayMs >> i) & 0xFF);
+  }
+  return crc;
+}
+
+static int slotAddr(uint8_t programId) {
+  return PROGRAMS_ADDR + (programId * PROGRAM_SIZE);
+}
+
+// Hash of a stored slot, 0 when the slot holds no loop program
+uint16_t programHash(uint8_t programId) {
+  ProgramRecord record;
+  eepromGet(slotAddr(programId), record);
+  if (record.header.type != PROGRAM_TYPE_LOOP) {
+    return 0;
+  }
+  return recordHash(0xFFFF, record);
+}
+
+// CRC over the shadow records of every slot in mask: as staged, or as the
+// EEPROM actually holds them once the queue has drained
+static uint16_t shadowCrc(uint8_t mask, bool stored) {
+  uint16_t crc = 0xFFFF;
+  for (uint8_t i = 0; i < MAX_PROGRAMS; i++) {
+    if (mask & (1 << i)) {
+      ProgramRecord record;
+      int addr = slotAddr(i) + PROGRAM_SHADOW_OFFSET;
+      if (stored) {
+        eepromReadStored(addr, &record, sizeof(record));
+      } else {
+        eepromGet(addr, record);
+      }
+      crc = recordHash(crc, record);
+    }
+  }
+  return crc;
+}
+
+static void clearSyncMarker() {
+  uint16_t magic = 0;
+  eepromPut(SYNC_MARKER_ADDR + offsetof(SyncMarker, magic), magic);
+}
+
+// Copy shadow records to their live slots, then retire the marker
+static void applyShadows(uint8_t mask) {
+  for (uint8_t i = 0; i < MAX_PROGRAMS; i++) {
+    if (!(mask & (1 << i))) {
+      continue;
+    }
+    ProgramRecord record;
+    eepromGet(slotAddr(i) + PROGRAM_SHADOW_OFFSET, record);
+    eepromPut(slotAddr(i), record);
+
+    if (i >= config.programCount) {
+      config.programCount = i + 1;
+    }
+  }
+  saveConfig();
+  clearSyncMarker();
+}
+
+static void sendSyncReport(uint8_t phase, uint8_t status, uint8_t mask) {
+  SyncReport report;
+  report.phase = phase;
+  report.status = status;
+  report.mask = mask;
+  sendReport(REPORT_SYNC, (const uint8_t *)&report, sizeof(report));
+}
+
+// Process one CMD_PROGRAM_SYNC sub-command
+void handleProgramSync(const char *data, int dataLen) {
+  if (dataLen < 1) {
+    return;
+  }
+  uint8_t sub = data[0];
+
+  switch (sub) {
+  case SYNC_MANIFEST: {
+    // Binary format: sub(1), mask(1), hash(2) x MAX_PROGRAMS
+    uint8_t mask = data[1];
+    uint8_t diff = 0;
+    for (uint8_t i = 0; i < MAX_PROGRAMS; i++) {
+      if (!(mask & (1 << i))) {
+        continue;
+      }
+      uint16_t hash = *(uint16_t *)(data + 2 + i * 2);
+      if (hash != programHash(i)) {
+        diff |= 1 << i;
+      }
+    }
+
+    // A stale marker must never pick up the shadows we are about to write
+    clearSyncMarker();
+    syncOpen = true;
+    stagedMask = 0;
+    sendSyncReport(SYNC_PHASE_DIFF, SYNC_OK, diff);
+    break;
+  }
+  case SYNC_SLOT: {
+    // Binary format: sub(1), programId(1), name(8), steps(2), delayMs(4)
+    uint8_t programId = data[1];
+    if (!syncOpen) {
+      sendSyncReport(SYNC_PHASE_COMMIT, SYNC_ERR_NO_TRANSACTION, 0);
+      return;
+    }
+    if (programId >= MAX_PROGRAMS) {
+      syncOpen = false;
+      sendSyncReport(SYNC_PHASE_COMMIT, SYNC_ERR_BAD_SLOT, stagedMask);
+      return;
+    }
+
+    ProgramRecord record;
+    record.header.type = PROGRAM_TYPE_LOOP;
+    record.header.reserved = 0;
+    memcpy(record.header.name, data + 2, 8);
+    record.header.name[8] = '\0';
+    record.params.steps = *(uint16_t *)(data + 10);
+    record.params.delayMs = *(uint32_t *)(data + 12);
+
+    eepromPut(slotAddr(programId) + PROGRAM_SHADOW_OFFSET, record);
+    stagedMask |= 1 << programId;
+    break;
+  }
+  case SYNC_COMMIT: {
+    // Binary format: sub(1), mask(1)
+    uint8_t mask = data[1];
+    if (!syncOpen) {
+      sendSyncReport(SYNC_PHASE_COMMIT, SYNC_ERR_NO_TRANSACTION, 0);
+      return;
+    }
+    syncOpen = false;
+    if (mask != stagedMask) {
+      sendSyncReport(SYNC_PHASE_COMMIT, SYNC_ERR_INCOMPLETE, stagedMask);
+      return;
+    }
+
+    if (mask) {
+      // Seal only what reached the EEPROM: a shadow that failed to write
+      // would otherwise be copied live under a valid marker
+      uint16_t crc = shadowCrc(mask, true);
+      if (crc != shadowCrc(mask, false)) {
+        sendSyncReport(SYNC_PHASE_COMMIT, SYNC_ERR_WRITE_FAILED, mask);
+        return;
+      }
+
+      // Queue order makes this atomic: shadows, marker, live copies, clear
+      SyncMarker marker;
+      marker.mask = mask;
+      marker.crc = crc;
+      marker.magic = SYNC_MARKER_MAGIC;
+      eepromPut(SYNC_MARKER_ADDR, marker);
+      applyShadows(mask);
+      buildMenuItems();
+    }
+    sendSyncReport(SYNC_PHASE_COMMIT, SYNC_OK, mask);
+    break;
+  }
+  case SYNC_ABORT:
+    syncOpen = false;
+    stagedMask = 0;
+    break;
+  }
+}
+
+// Roll a committed-but-unfinished sync forward (called from loadConfig)
+void recoverProgramSync() {
+  SyncMarker marker;
+  eepromGet(SYNC_MARKER_ADDR, marker);
+  if (marker.magic != SYNC_MARKER_MAGIC) {
+    return;
+  }
+
+  if (marker.mask < (1 << MAX_PROGRAMS) &&
+      marker.crc == shadowCrc(marker.mask, true)) {
+    applyShadows(marker.mask);
+  } else {
+    clearSyncMarker(); // Shadows never completed; live slots are intact
+  }
+}
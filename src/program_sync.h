@@ -0,0 +1,52 @@
+#ifndef PROGRAM_SYNC_H
+#define PROGRAM_SYNC_H
+
+#include <Arduino.h>
+
+#include "config_manager.h"
+
+// Batch program sync: the host sends a manifest of per-slot hashes, the
+// device answers with the slots that differ, only those are staged into
+// each slot's shadow copy, and a commit marker makes the switch atomic.
+enum SyncCommand {
+  SYNC_MANIFEST = 0, // mask(1), hash(2) x MAX_PROGRAMS -> REPORT_SYNC diff
+  SYNC_SLOT = 1,     // programId(1), name(8), steps(2), delayMs(4)
+  SYNC_COMMIT = 2,   // mask(1) of slots the host staged -> REPORT_SYNC result
+  SYNC_ABORT = 3     // Drop anything staged so far
+};
+
+// REPORT_SYNC payload
+enum SyncPhase { SYNC_PHASE_DIFF = 0, SYNC_PHASE_COMMIT = 1 };
+enum SyncStatus {
+  SYNC_OK = 0,
+  SYNC_ERR_NO_TRANSACTION = 1, // Slot or commit without a manifest
+  SYNC_ERR_INCOMPLETE = 2,     // Commit mask does not match staged slots
+  SYNC_ERR_BAD_SLOT = 3,       // Slot id out of range
+  SYNC_ERR_WRITE_FAILED = 4    // A staged shadow did not read back intact
+};
+
+struct SyncReport {
+  uint8_t phase;  // SyncPhase
+  uint8_t status; // SyncStatus
+  uint8_t mask;   // Diff mask (DIFF) or committed slots (COMMIT)
+};
+
+// Shadow record lives in the unused tail of each 128-byte program slot
+const int PROGRAM_SHADOW_OFFSET = 32;
+
+// Commit marker, written after all shadows and cleared after the copy.
+// magic is the last field so a torn write never looks valid.
+struct SyncMarker {
+  uint8_t mask;   // Slots to copy from shadow to live
+  uint16_t crc;   // CRC over the shadow records in mask
+  uint16_t magic; // SYNC_MARKER_MAGIC when a commit is in progress
+};
+
+const uint16_t SYNC_MARKER_MAGIC = 0x5C0D;
+
+// Function declarations
+uint16_t programHash(uint8_t programId);
+void handleProgramSync(const char *data, int dataLen);
+void recoverProgramSync(); // Finish a commit interrupted by power loss
+
+#endif // PROGRAM_SYNC_H
@@ -0,0 +1,365 @@
+#include "recorder.h"
+#include "command_processor.h"
+#include "eeprom_queue.h"
+#include "motor_control.h"
+
+// Encoded stream of second differences: dd = this tick's delta minus the
+// previous tick's. Jog jitter and steady acceleration keep dd within -1..1,
+// so most ticks pack four to a byte. Tokens:
+//   0..80     four ticks, dd in -1..1 (base 3, first tick in the lowest digit)
+//   81..254   one tick, dd = unzigzag(token - 81)
+//   255       a run of equal dd: varint(zigzag(dd)) varint(ticks)
+const uint8_t TOKEN_SINGLE = 81;
+const uint8_t TOKEN_RUN = 255;
+const uint8_t SINGLE_MAX = TOKEN_RUN - TOKEN_SINGLE - 1; // Largest zigzag(dd)
+const uint8_t PACK_RUN_MAX = 12; // Longer -1..1 runs are cheaper as a run
+
+// Recording state
+static struct {
+  bool active;
+  uint8_t tickMs;
+  uint16_t length;      // Encoded bytes written so far
+  uint32_t ticks;       // Ticks sampled so far
+  uint32_t storedTicks; // Ticks covered by the bytes written
+  uint32_t lastTickMs;  // Time of the last sampled tick
+  long lastPosition;    // Position at the last sampled tick
+  long startPosition;   // Position when recording started
+  int32_t lastDelta;    // Delta of the last sampled tick
+  int32_t runDd;        // Second difference of the pending run
+  uint32_t runTicks;    // Ticks in the pending run (0 = none)
+  uint8_t packed;       // Base-3 digits of the pending packed ticks
+  uint8_t packedTicks;  // Ticks in that byte so far
+} rec;
+
+// Playback state
+static struct {
+  int addr;            // Next encoded byte
+  int endAddr;         // End of the encoded stream
+  int32_t delta;       // Delta of the last tick played
+  int32_t dd;          // Second difference of the run being played
+  uint32_t ticks;      // Ticks left in that run
+  uint8_t packed;      // Remaining digits of a packed token
+  uint8_t packedTicks; // Ticks left in it
+  uint32_t tickUs;     // Tick length after time scaling
+} play;
+
+static void sendRecordReport(uint8_t status) {
+  RecordingHeader header;
+  eepromGet(RECORDING_ADDR, header);
+
+  RecordReport report;
+  report.capacity = RECORDING_CAPACITY;
+  if (status == RECORD_RECORDING) {
+    report.tickMs = rec.tickMs;
+    report.length = rec.length;
+    report.ticks = rec.ticks;
+  } else if (header.length == 0 || header.length == 0xFFFF) {
+    status = RECORD_EMPTY;
+    report.tickMs = 0;
+    report.length = 0;
+    report.ticks = 0;
+  } else {
+    report.tickMs = header.tickMs;
+    report.length = header.length;
+    report.ticks = header.ticks;
+  }
+  report.status = status;
+  sendReport(REPORT_RECORDING, (const uint8_t *)&report, sizeof(report));
+}
+
+static uint8_t putVarint(uint8_t *out, uint32_t value) {
+  uint8_t n = 0;
+  while (value >= 0x80) {
+    out[n++] = (value & 0x7F) | 0x80;
+    value >>= 7;
+  }
+  out[n++] = value;
+  return n;
+}
+
+static bool getVarint(uint32_t &value) {
+  value = 0;
+  for (uint8_t shift = 0; shift < 35 && play.addr < play.endAddr;
+       shift += 7) {
+    uint8_t byte;
+    eepromGet(play.addr++, byte);
+    value |= (uint32_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false; // Truncated stream
+}
+
+static uint32_t zigzag(int32_t value) {
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value) {
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+// Write a token covering ticks; false if it no longer fits
+static bool emit(const uint8_t *token, uint8_t n, uint32_t ticks) {
+  if (rec.length + n > RECORDING_CAPACITY) {
+    return false;
+  }
+  eepromQueueWrite(RECORDING_DATA_ADDR + rec.length, token, n);
+  rec.length += n;
+  rec.storedTicks += ticks;
+  return true;
+}
+
+// Write a partly filled packed byte as single-tick tokens
+static bool flushPacked() {
+  for (; rec.packedTicks > 0; rec.packedTicks--) {
+    uint8_t token = TOKEN_SINGLE + zigzag(rec.packed % 3 - 1);
+    if (!emit(&token, 1, 1)) {
+      return false;
+    }
+    rec.packed /= 3;
+  }
+  rec.packed = 0;
+  return true;
+}
+
+// Write the pending run; false if it no longer fits
+static bool flushRun() {
+  static const uint8_t weight[] = {1, 3, 9, 27};
+
+  if (rec.runTicks == 0) {
+    return true;
+  }
+
+  uint32_t code = zigzag(rec.runDd);
+  if (rec.runDd >= -1 && rec.runDd <= 1 && rec.runTicks < PACK_RUN_MAX) {
+    for (; rec.runTicks > 0; rec.runTicks--) {
+      rec.packed += (rec.runDd + 1) * weight[rec.packedTicks++];
+      if (rec.packedTicks == 4) {
+        if (!emit(&rec.packed, 1, 4)) {
+          return false;
+        }
+        rec.packed = 0;
+        rec.packedTicks = 0;
+      }
+    }
+    return true;
+  }
+
+  if (!flushPacked()) {
+    return false;
+  }
+  if (code <= SINGLE_MAX && rec.runTicks <= 3) {
+    for (; rec.runTicks > 0; rec.runTicks--) {
+      uint8_t token = TOKEN_SINGLE + code;
+      if (!emit(&token, 1, 1)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  uint8_t token[11];
+  token[0] = TOKEN_RUN;
+  uint8_t n = 1 + putVarint(token + 1, code);
+  n += putVarint(token + n, rec.runTicks);
+  if (!emit(token, n, rec.runTicks)) {
+    return false;
+  }
+  rec.runTicks = 0;
+  return true;
+}
+
+// Save the header last, so an interrupted recording reads as empty
+static void finishRecording(uint8_t status) {
+  rec.active = false;
+
+  RecordingHeader header;
+  header.length = rec.length;
+  header.ticks = rec.storedTicks; // Less any ticks that did not fit
+  header.startMicrosteps = rec.startPosition;
+  header.tickMs = rec.tickMs;
+  eepromPut(RECORDING_ADDR, header);
+
+  sendRecordReport(status);
+}
+
+static void appendDelta(int32_t delta) {
+  int32_t dd = delta - rec.lastDelta;
+  rec.lastDelta = delta;
+  if (rec.runTicks > 0 && dd == rec.runDd) {
+    rec.runTicks++;
+  } else {
+    if (!flushRun()) {
+      finishRecording(RECORD_FULL);
+      return;
+    }
+    rec.runDd = dd;
+    rec.runTicks = 1;
+  }
+  rec.ticks++;
+}
+
+void startRecording(uint8_t tickMs) {
+  // Mark the old recording invalid before overwriting its data
+  uint16_t none = 0;
+  eepromPut(RECORDING_ADDR + offsetof(RecordingHeader, length), none);
+
+  rec.active = true;
+  rec.tickMs = tickMs ? constrain(tickMs, 5, 250) : RECORD_TICK_MS;
+  rec.length = 0;
+  rec.ticks = 0;
+  rec.storedTicks = 0;
+  rec.lastDelta = 0;
+  rec.runTicks = 0;
+  rec.packed = 0;
+  rec.packedTicks = 0;
+  rec.lastTickMs = millis();
+  rec.lastPosition = rec.startPosition = positionMicrosteps();
+  sendRecordReport(RECORD_RECORDING);
+}
+
+void stopRecording() {
+  if (!rec.active) {
+    return;
+  }
+  finishRecording(flushRun() && flushPacked() ? RECORD_SAVED : RECORD_FULL);
+}
+
+bool recordingActive() { return rec.active; }
+
+void recorderService() {
+  if (!rec.active) {
+    return;
+  }
+
+  uint32_t due = (millis() - rec.lastTickMs) / rec.tickMs;
+  if (due == 0) {
+    return;
+  }
+  rec.lastTickMs += due * rec.tickMs;
+
+  // If the loop stalled for several ticks, spread the movement over them
+  // so the recorded velocity stays right
+  long position = positionMicrosteps();
+  long moved = position - rec.lastPosition;
+  rec.lastPosition = position;
+  for (uint32_t i = 0; i < due && rec.active; i++) {
+    long done = moved * (long)i / (long)due;
+    appendDelta(moved * (long)(i + 1) / (long)due - done);
+  }
+}
+
+// Queue one tick: its microsteps evenly spread, then the rounding remainder
+// as a dwell so every tick lasts exactly tickUs
+static void queueTick(int32_t delta) {
+  uint32_t count = delta < 0 ? -delta : delta;
+  if (count == 0) {
+    queueSegment(0, play.tickUs);
+    return;
+  }
+  uint32_t periodUs = play.tickUs / count;
+  queueSegment(delta, periodUs);
+  if (play.tickUs > periodUs * count) {
+    queueSegment(0, play.tickUs - periodUs * count);
+  }
+}
+
+// Read the next token into the playback run; false at the end
+static bool nextToken() {
+  if (play.packedTicks == 0) {
+    if (play.addr >= play.endAddr) {
+      return false; // End of recording
+    }
+    uint8_t token;
+    eepromGet(play.addr++, token);
+    if (token == TOKEN_RUN) {
+      uint32_t code;
+      if (!getVarint(code) || !getVarint(play.ticks)) {
+        return false;
+      }
+      play.dd = unzigzag(code);
+      return true;
+    }
+    play.ticks = 1;
+    if (token >= TOKEN_SINGLE) {
+      play.dd = unzigzag(token - TOKEN_SINGLE);
+      return true;
+    }
+    play.packed = token;
+    play.packedTicks = 4;
+  }
+  play.dd = play.packed % 3 - 1;
+  play.packed /= 3;
+  play.packedTicks--;
+  play.ticks = 1;
+  return true;
+}
+
+// MotionPlanner: decode the next tick into segments
+static bool planPlayback() {
+  if (motionQueueSpace() < 2) {
+    return true; // A tick may need two segments; try again later
+  }
+  if (play.ticks == 0 && !nextToken()) {
+    return false;
+  }
+  play.ticks--;
+  play.delta += play.dd;
+  queueTick(play.delta);
+  return true;
+}
+
+void playRecording(uint16_t timeScale) {
+  stopRecording();
+
+  RecordingHeader header;
+  eepromGet(RECORDING_ADDR, header);
+  if (header.length == 0 || header.length > RECORDING_CAPACITY) {
+    sendRecordReport(RECORD_EMPTY);
+    return;
+  }
+
+  timeScale = timeScale ? constrain(timeScale, 10, 1000) : 100;
+  play.addr = RECORDING_DATA_ADDR;
+  play.endAddr = RECORDING_DATA_ADDR + header.length;
+  play.delta = 0;
+  play.ticks = 0;
+  play.packedTicks = 0;
+  play.tickUs = (uint32_t)header.tickMs * 10UL * timeScale;
+
+  // Return to where the recording started, then replay the deltas
+  long seek = header.startMicrosteps - positionMicrosteps();
+  if (seek != 0) {
+    queueSegment(seek, RECORD_SEEK_PERIOD_US);
+  }
+
+  programRunning = true;
+  programPaused = false;
+  runMotionQueue(planPlayback, true);
+}
+
+void handleRecordCommand(const char *data, int dataLen) {
+  if (dataLen < 1) {
+    return;
+  }
+
+  switch (data[0]) {
+  case RECORD_START:
+    startRecording(dataLen >= 2 ? (uint8_t)data[1] : 0);
+    break;
+  case RECORD_STOP:
+    if (rec.active) {
+      stopRecording();
+    } else {
+      sendRecordReport(RECORD_SAVED);
+    }
+    break;
+  case RECORD_PLAY:
+    playRecording(dataLen >= 3 ? *(uint16_t *)(data + 1) : 0);
+    break;
+  case RECORD_INFO:
+    sendRecordReport(rec.active ? RECORD_RECORDING : RECORD_SAVED);
+    break;
+  }
+}
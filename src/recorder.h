@@ -0,0 +1,61 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <Arduino.h>
+
+#include "config_manager.h"
+
+// Record-and-playback of manual (jog) moves. While recording, the position
+// is sampled every tick and the change in the per-tick microstep delta is
+// stored in EEPROM. Jitter and steady ramps pack four ticks to a byte, and a
+// run of equal changes is stored once with a repeat count, so holds and
+// constant-velocity stretches cost a few bytes.
+const uint8_t RECORD_TICK_MS = 20;           // Default sampling tick
+const uint32_t RECORD_SEEK_PERIOD_US = 1000; // Return-to-start microstep period
+
+// Recording sub-commands (CMD_RECORD)
+enum RecordCommand {
+  RECORD_START = 0, // tickMs(1, optional)
+  RECORD_STOP = 1,  // Flush and save
+  RECORD_PLAY = 2,  // timeScale(2, optional, percent; 200 = half speed)
+  RECORD_INFO = 3   // Report the stored recording
+};
+
+// Recording state (REPORT_RECORDING status)
+enum RecordStatus {
+  RECORD_SAVED = 0,     // Stored and ready to play
+  RECORD_FULL = 1,      // Storage ran out; saved up to that point
+  RECORD_EMPTY = 2,     // Nothing stored
+  RECORD_RECORDING = 3  // Recording in progress
+};
+
+// Stored ahead of the encoded deltas; written last when a recording stops
+struct RecordingHeader {
+  uint16_t length;         // Encoded bytes (0 or 0xFFFF = none)
+  uint32_t ticks;          // Recorded duration in ticks
+  int32_t startMicrosteps; // Position when recording started
+  uint8_t tickMs;          // Sampling tick
+};
+
+struct RecordReport {
+  uint8_t status;   // RecordStatus
+  uint8_t tickMs;   // Sampling tick
+  uint16_t length;  // Encoded bytes
+  uint32_t ticks;   // Duration in ticks
+  uint16_t capacity; // Bytes available for encoded deltas
+};
+
+// Recording uses the EEPROM between the homing and the driver settings
+const int RECORDING_ADDR = HOMING_ADDR + sizeof(HomingConfig);
+const int RECORDING_DATA_ADDR = RECORDING_ADDR + sizeof(RecordingHeader);
+const int RECORDING_CAPACITY = DRIVER_ADDR - RECORDING_DATA_ADDR;
+
+// Function declarations
+void handleRecordCommand(const char *data, int dataLen);
+void startRecording(uint8_t tickMs);
+void stopRecording();
+bool recordingActive();
+void recorderService(); // Call every loop() pass; samples due ticks
+void playRecording(uint16_t timeScale); // Blocking, through the motion queue
+
+#endif // RECORDER_H
@@ -0,0 +1,83 @@
+#include "self_test.h"
+#include "command_processor.h"
+#include "config_manager.h"
+#include "display_manager.h"
+#include "motor_control.h"
+
+// Microstep periods swept from slow to fast (250 Hz .. 20 kHz)
+static const uint32_t SELF_TEST_PERIODS_US[SELF_TEST_RATE_COUNT] PROGMEM = {
+    4000, 2000, 1000, 500, 250, 125, 80, 50};
+
+static uint16_t clamp16(uint32_t value) {
+  return value > 0xFFFF ? 0xFFFF : (uint16_t)value;
+}
+
+// Run each rate through runMicrosteps(), the same path every move uses, with
+// the yield callback and display refresh active. Each rate runs forward then
+// back by the same count so a live run ends where it started.
+void runSelfTest(uint8_t flags, uint16_t msPerRate) {
+  if (msPerRate == 0) {
+    msPerRate = SELF_TEST_DEFAULT_MS;
+  }
+
+  struct {
+    SelfTestHeader header;
+    SelfTestEntry entries[SELF_TEST_RATE_COUNT];
+  } report;
+
+  report.header.version = 1;
+  report.header.flags = flags;
+  report.header.cpuMhz = F_CPU / 1000000UL;
+  report.header.microstepping = DEFAULT_MICROSTEPPING;
+  report.header.count = 0;
+
+  bool wasRunning = programRunning;
+  programRunning = true;
+  programPaused = false;
+  setStepOutputEnabled(!(flags & SELF_TEST_DRY_RUN));
+  displayMessage(F("Self Test"), 0);
+
+  for (uint8_t r = 0; r < SELF_TEST_RATE_COUNT; r++) {
+    uint32_t periodUs = pgm_read_dword(&SELF_TEST_PERIODS_US[r]);
+    long half = (msPerRate * 1000UL / periodUs) / 2;
+    if (half < 1) {
+      half = 1;
+    }
+
+    resetMotionStats();
+    runMicrosteps(half, true, periodUs);
+    runMicrosteps(half, false, periodUs);
+
+    SelfTestEntry &entry = report.entries[r];
+    entry.periodUs = periodUs;
+    entry.steps = motionStats.steps;
+    uint32_t budgetMs = motionStats.steps * periodUs / 1000;
+    entry.achievedUs = motionStats.steps > 1
+                           ? motionStats.elapsedUs / (motionStats.steps - 1)
+                           : 0;
+    entry.headroom = budgetMs ? clamp16(motionStats.slackUs / budgetMs) : 0;
+    entry.minSlackUs = clamp16(motionStats.minSlackUs);
+    entry.maxLateUs = clamp16(motionStats.maxLateUs);
+    entry.missed = clamp16(motionStats.missed);
+    report.header.count++;
+
+    if (!programRunning || programPaused) {
+      break; // Aborted from the button or a stop
+    }
+  }
+
+  setStepOutputEnabled(true);
+  programRunning = wasRunning;
+
+  // A pause only ends the test; there is nothing to resume afterwards
+  programPaused = false;
+  dropPausedRun();
+  if (inPauseMenu) {
+    exitPauseMenu();
+  }
+
+  sendReport(REPORT_SELF_TEST, (const uint8_t *)&report,
+             sizeof(SelfTestHeader) +
+                 report.header.count * sizeof(SelfTestEntry));
+  displayMessage(F("Test Done"));
+}
@@ -0,0 +1,35 @@
+#ifndef SELF_TEST_H
+#define SELF_TEST_H
+
+#include <Arduino.h>
+
+// Self-test flags (first payload byte of CMD_SELF_TEST)
+const uint8_t SELF_TEST_DRY_RUN = 0x01; // Gate STEP output, carriage stays put
+
+// Step rate sweep, expressed as microstep periods in microseconds
+const uint8_t SELF_TEST_RATE_COUNT = 8;
+const uint16_t SELF_TEST_DEFAULT_MS = 250; // Time spent at each rate
+
+// Report layout (little-endian, sent as one REPORT_SELF_TEST frame)
+struct SelfTestHeader {
+  uint8_t version;       // Report layout version
+  uint8_t flags;         // Flags the test ran with
+  uint8_t cpuMhz;        // F_CPU in MHz
+  uint8_t microstepping; // Microsteps per full step
+  uint8_t count;         // Number of SelfTestEntry records that follow
+};
+
+struct SelfTestEntry {
+  uint32_t periodUs;   // Requested microstep period
+  uint32_t achievedUs; // Mean period actually achieved
+  uint32_t steps;      // Pulses issued at this rate
+  uint16_t headroom;   // Mean idle share of each period, per mille
+  uint16_t minSlackUs; // Tightest idle margin seen before a pulse
+  uint16_t maxLateUs;  // Worst delay of a pulse past its deadline
+  uint16_t missed;     // Pulses that ran more than a full period late
+};
+
+// Function declarations
+void runSelfTest(uint8_t flags, uint16_t msPerRate);
+
+#endif // SELF_TEST_H
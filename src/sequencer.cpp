@@ -0,0 +1,126 @@
+#include "sequencer.h"
+#include "display_manager.h"
+#include "motor_control.h"
+
+// Where the planner is within the current program cycle
+enum SequencePhase {
+  PHASE_FORWARD,  // Next: forward run
+  PHASE_BACKWARD, // Next: backward run
+  PHASE_CYCLE_END // Next: repeat, or hand over to the next entry
+};
+
+// Planner state. Segments are produced ahead of execution, so the first
+// segment of the next program is queued before the current one finishes.
+static struct {
+  bool playlist;        // Playlist (finite entries) or single program
+  uint8_t playlistId;   // Playlist being played
+  uint8_t entryIndex;   // Current playlist entry
+  uint8_t repeatsLeft;  // Cycles left in the current entry
+  uint8_t phase;        // SequencePhase
+  bool finished;        // Playlist ran out of entries
+  Playlist list;        // Entries of the playlist being played
+  LoopProgram program;  // Program of the current entry
+  uint32_t periodUs;    // Microstep period of the current program
+} seq;
+
+static void loadProgramForPlan(uint8_t programId) {
+  loadLoopProgram(programId, &seq.program);
+  seq.periodUs = microstepPeriodUs(seq.program.delayMs);
+}
+
+// Load the entry at entryIndex, skipping slots that hold no loop program
+static bool loadEntry() {
+  for (uint8_t tries = 0; tries < seq.list.count; tries++) {
+    if (seq.entryIndex >= seq.list.count) {
+      if (!(seq.list.flags & PLAYLIST_FLAG_LOOP)) {
+        return false;
+      }
+      seq.entryIndex = 0;
+    }
+
+    PlaylistEntry &entry = seq.list.entries[seq.entryIndex];
+    if (getProgramType(entry.programId) == PROGRAM_TYPE_LOOP) {
+      loadProgramForPlan(entry.programId);
+      seq.repeatsLeft = entry.repeats ? entry.repeats : 1;
+      return true;
+    }
+    seq.entryIndex++;
+  }
+  return false;
+}
+
+bool startProgramSequence(uint8_t programId) {
+  if (getProgramType(programId) != PROGRAM_TYPE_LOOP) {
+    return false;
+  }
+  seq.playlist = false;
+  seq.finished = false;
+  seq.phase = PHASE_FORWARD;
+  loadProgramForPlan(programId);
+  return true;
+}
+
+bool startPlaylistSequence(uint8_t playlistId) {
+  if (!loadPlaylist(playlistId, &seq.list)) {
+    return false;
+  }
+  seq.playlist = true;
+  seq.playlistId = playlistId;
+  seq.entryIndex = 0;
+  seq.finished = false;
+  seq.phase = PHASE_FORWARD;
+  return loadEntry();
+}
+
+// Queue the next segment of the sequence; false once a playlist is done
+bool planSequence() {
+  long travel = (long)seq.program.steps * DEFAULT_MICROSTEPPING;
+
+  switch (seq.phase) {
+  case PHASE_FORWARD:
+    seq.phase = PHASE_BACKWARD;
+    return queueSegment(travel, seq.periodUs);
+
+  case PHASE_BACKWARD:
+    seq.phase = PHASE_CYCLE_END;
+    return queueSegment(-travel, seq.periodUs);
+
+  case PHASE_CYCLE_END:
+  default: {
+    seq.phase = PHASE_FORWARD;
+    if (!seq.playlist || --seq.repeatsLeft > 0) {
+      return planSequence();
+    }
+
+    // Hand over to the next entry, with its transition dwell if any
+    uint16_t dwellMs = seq.list.entries[seq.entryIndex].dwellMs;
+    seq.entryIndex++;
+    if (!loadEntry()) {
+      seq.finished = true;
+      return false;
+    }
+    if (dwellMs > 0) {
+      return queueSegment(0, dwellMs * 1000UL);
+    }
+    return planSequence();
+  }
+  }
+}
+
+bool sequenceFinished() { return seq.finished; }
+
+// Play a stored playlist until it ends, or is paused/stopped
+void runPlaylist(uint8_t playlistId) {
+  if (!startPlaylistSequence(playlistId)) {
+    TEXT_LOG(F("ERROR: Invalid playlist"));
+    programRunning = false;
+    return;
+  }
+
+  runMotionQueue(planSequence, true);
+
+  if (sequenceFinished()) {
+    programRunning = false;
+    displayMessage(F("Done"));
+  }
+}
@@ -0,0 +1,18 @@
+#ifndef SEQUENCER_H
+#define SEQUENCER_H
+
+#include <Arduino.h>
+
+#include "config_manager.h"
+
+// Program id bit selecting a playlist instead (CMD_RUN, synced runs)
+const uint8_t RUN_PLAYLIST_FLAG = 0x80;
+
+// Function declarations
+bool startProgramSequence(uint8_t programId);  // Single program, forever
+bool startPlaylistSequence(uint8_t playlistId); // Stored playlist
+bool planSequence(); // MotionPlanner: queue the next segment
+bool sequenceFinished();
+void runPlaylist(uint8_t playlistId);
+
+#endif // SEQUENCER_H
@@ -0,0 +1,274 @@
+#include "sync_line.h"
+#include "command_processor.h"
+#include "config_manager.h"
+#include "jog_control.h"
+#include "motor_control.h"
+#include "sequencer.h"
+#include "trajectory.h"
+
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+#endif
+
+volatile bool syncListening = false;
+volatile uint32_t syncEdgeUs = 0;
+volatile uint16_t syncEdges = 0;
+volatile bool syncLineLow = false;
+
+const uint32_t TICK_US = SYNC_TICK_MS * 1000UL;
+
+static uint8_t mode = SYNC_LINE_OFF;
+static uint8_t flags = 0;
+static uint8_t state = SYNC_LINE_IDLE;
+
+// Run to start on the edge: a stored program/playlist, or a move
+static struct {
+  bool move;
+  uint8_t programId;
+  uint16_t position;
+  uint32_t speedMs;
+} armed;
+
+// Run in progress: start edge and the tick bookkeeping against it
+static uint32_t originUs = 0;
+static uint16_t seenEdges = 0;
+static int16_t lastErrorUs = 0;
+static uint16_t maxErrorUs = 0;
+
+static void sendSyncLineReport() {
+  SyncLineReport report;
+  report.mode = mode;
+  report.flags = flags;
+  report.state = state;
+  noInterrupts();
+  report.ticks = syncEdges ? syncEdges - 1 : 0; // Less the start edge
+  interrupts();
+  report.lastErrorUs = lastErrorUs;
+  report.maxErrorUs = maxErrorUs;
+  sendReport(REPORT_SYNC_LINE, (const uint8_t *)&report, sizeof(report));
+}
+
+#if defined(__AVR__)
+// Master ticks come from Timer3 so they stay on the crystal timebase no
+// matter what the foreground is doing. Compare A starts each pulse and
+// compare B ends it, so the ISR never waits out the pulse width.
+ISR(TIMER3_COMPA_vect) {
+  digitalWrite(SYNC_PIN, LOW);
+  syncEdges++;
+}
+
+ISR(TIMER3_COMPB_vect) { digitalWrite(SYNC_PIN, HIGH); }
+
+// Timer3 in CTC mode, clk/256, one compare match per tick from now
+static void startTicks() {
+  TCCR3A = 0;
+  TCCR3B = 0;
+  TCNT3 = 0;
+  OCR3A = (uint32_t)(F_CPU / 256) * SYNC_TICK_MS / 1000 - 1;
+  OCR3B = (uint32_t)(F_CPU / 256) * SYNC_PULSE_US / 1000000;
+  TIFR3 = _BV(OCF3A) | _BV(OCF3B);
+  TIMSK3 = _BV(OCIE3A) | _BV(OCIE3B);
+  TCCR3B = _BV(WGM32) | _BV(CS32);
+}
+
+static void stopTicks() {
+  TIMSK3 = 0;
+  TCCR3B = 0;
+  if (mode == SYNC_LINE_MASTER) {
+    digitalWrite(SYNC_PIN, HIGH); // Stopped mid-pulse
+  }
+}
+#else
+static uint32_t nextTickUs = 0;
+
+static void syncInterrupt() { syncPinChange(); }
+
+static void pulseLine() {
+  digitalWrite(SYNC_PIN, LOW);
+  delayMicroseconds(SYNC_PULSE_US);
+  digitalWrite(SYNC_PIN, HIGH);
+}
+
+// No spare timer: ticks are polled from the step engine
+static void startTicks() { nextTickUs = micros() + TICK_US; }
+
+static void stopTicks() {}
+#endif
+
+void setupSyncLine() {
+  pinMode(SYNC_PIN, INPUT_PULLUP);
+#if defined(__AVR__)
+  // Shares PCINT0 with the button; the handler lives in power_manager.cpp
+  *digitalPinToPCMSK(SYNC_PIN) |= _BV(digitalPinToPCMSKbit(SYNC_PIN));
+  *digitalPinToPCICR(SYNC_PIN) |= _BV(digitalPinToPCICRbit(SYNC_PIN));
+#else
+  attachInterrupt(digitalPinToInterrupt(SYNC_PIN), syncInterrupt, FALLING);
+#endif
+}
+
+static void setMode(uint8_t newMode, uint8_t newFlags) {
+  syncListening = false;
+  state = SYNC_LINE_IDLE;
+  mode = newMode <= SYNC_LINE_FOLLOWER ? newMode : SYNC_LINE_OFF;
+  flags = newFlags & SYNC_LINE_PHASE_LOCK;
+
+  if (mode == SYNC_LINE_MASTER) {
+    digitalWrite(SYNC_PIN, HIGH);
+    pinMode(SYNC_PIN, OUTPUT);
+  } else {
+    pinMode(SYNC_PIN, INPUT_PULLUP);
+  }
+}
+
+static void arm() {
+  if (mode == SYNC_LINE_OFF) {
+    return;
+  }
+  noInterrupts();
+  syncEdges = 0;
+  syncLineLow = digitalRead(SYNC_PIN) == LOW;
+  interrupts();
+  lastErrorUs = 0;
+  maxErrorUs = 0;
+  state = SYNC_LINE_ARMED;
+  syncListening = mode == SYNC_LINE_FOLLOWER;
+}
+
+void handleSyncLineCommand(const char *data, int dataLen) {
+  uint8_t command = dataLen >= 1 ? (uint8_t)data[0] : SYNC_LINE_QUERY;
+
+  switch (command) {
+  case SYNC_LINE_SET_MODE:
+    setMode(data[1], data[2]);
+    break;
+  case SYNC_LINE_ARM_RUN:
+    armed.move = false;
+    armed.programId = data[1];
+    arm();
+    break;
+  case SYNC_LINE_ARM_MOVE:
+    armed.move = true;
+    armed.position = *(uint16_t *)(data + 1);
+    armed.speedMs = *(uint32_t *)(data + 3);
+    arm();
+    break;
+  case SYNC_LINE_DISARM:
+    syncListening = false;
+    state = SYNC_LINE_IDLE;
+    break;
+  }
+  sendSyncLineReport();
+}
+
+// Start the armed run on a timebase SYNC_LEAD_MS after the start edge
+static void runSynced(uint32_t edgeUs) {
+  originUs = edgeUs;
+  seenEdges = 1;
+  state = SYNC_LINE_RUNNING;
+
+  // Only hand the origin to a run that will actually start
+  uint8_t id = armed.programId & ~RUN_PLAYLIST_FLAG;
+  bool playlist = armed.programId & RUN_PLAYLIST_FLAG;
+  Playlist stored;
+  bool valid = armed.move ||
+               (playlist ? loadPlaylist(id, &stored)
+                         : getProgramType(id) == PROGRAM_TYPE_LOOP);
+
+  if (valid) {
+    jogHalt();
+    pvtHalt();
+    programRunning = true;
+    programPaused = false;
+    setMotionOrigin(edgeUs + SYNC_LEAD_MS * 1000UL);
+
+    if (armed.move) {
+      moveToPositionWithSpeed(armed.position, armed.speedMs);
+    } else if (playlist) {
+      runPlaylist(id);
+    } else {
+      runLoopProgram(id);
+    }
+  }
+
+  stopTicks();
+  syncListening = false;
+  state = SYNC_LINE_IDLE;
+  sendSyncLineReport();
+}
+
+void syncLineService() {
+  if (state != SYNC_LINE_ARMED) {
+    return;
+  }
+
+  uint32_t edgeUs;
+  if (mode == SYNC_LINE_MASTER) {
+    // Falling edge and tick timer together, so ticks and the origin count
+    // from the edge the followers stamp; compare B ends the pulse
+    noInterrupts();
+    digitalWrite(SYNC_PIN, LOW);
+    edgeUs = micros();
+    startTicks();
+    syncEdges = 1;
+    interrupts();
+#if !defined(__AVR__)
+    delayMicroseconds(SYNC_PULSE_US);
+    digitalWrite(SYNC_PIN, HIGH);
+#endif
+  } else {
+    noInterrupts();
+    uint16_t edges = syncEdges;
+    edgeUs = syncEdgeUs;
+    interrupts();
+    if (edges == 0) {
+      return;
+    }
+  }
+  runSynced(edgeUs);
+}
+
+// Called by the step engine between pulses. A follower compares each tick
+// with where its own timebase expects it and, when phase-locked, moves the
+// timebase half of the way: clock drift between units is tracked out
+// without jumps, and a glitch on the line is ignored.
+int32_t syncTimebaseCorrection() {
+  if (state != SYNC_LINE_RUNNING) {
+    return 0;
+  }
+#if !defined(__AVR__)
+  if (mode == SYNC_LINE_MASTER && (int32_t)(micros() - nextTickUs) >= 0) {
+    pulseLine();
+    syncEdges++;
+    nextTickUs += TICK_US;
+  }
+#endif
+  if (mode != SYNC_LINE_FOLLOWER) {
+    return 0;
+  }
+
+  noInterrupts();
+  uint16_t edges = syncEdges;
+  uint32_t edgeUs = syncEdgeUs;
+  interrupts();
+  if (edges == seenEdges) {
+    return 0;
+  }
+  seenEdges = edges;
+
+  // Index the tick by its time rather than by counting edges, so a missed
+  // or spurious edge does not throw every later tick off by a period
+  uint32_t tickIndex = (edgeUs - originUs + TICK_US / 2) / TICK_US;
+  int32_t error = (int32_t)(edgeUs - (originUs + tickIndex * TICK_US));
+  lastErrorUs = constrain(error, -32767L, 32767L);
+  uint32_t magnitude = abs(error);
+  if (magnitude > maxErrorUs) {
+    maxErrorUs = min(magnitude, 0xFFFFUL);
+  }
+
+  if (!(flags & SYNC_LINE_PHASE_LOCK) || magnitude > SYNC_MAX_CORRECTION_US) {
+    return 0;
+  }
+  int32_t shift = error / 2;
+  originUs += shift;
+  return shift;
+}
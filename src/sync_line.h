@@ -0,0 +1,74 @@
+#ifndef SYNC_LINE_H
+#define SYNC_LINE_H
+
+#include <Arduino.h>
+
+// Multi-unit start over a shared sync line (SYNC_PIN and GND wired between
+// units). The master pulls the line low briefly to start, then every
+// SYNC_TICK_MS while its run lasts. Followers armed with a program or a move
+// start on the start edge, timestamped by the pin-change interrupt, and can
+// phase-lock their step timebase to the ticks. Every unit begins stepping
+// SYNC_LEAD_MS after the edge, which hides how long each takes to load its
+// run.
+const int SYNC_PIN = 11;                     // PB7 / PCINT7
+const uint16_t SYNC_TICK_MS = 100;           // Tick period while running
+const uint16_t SYNC_LEAD_MS = 20;            // Start edge to the run's timebase
+const uint16_t SYNC_PULSE_US = 500;          // Pulse width, >> ISR latency
+const uint16_t SYNC_MAX_CORRECTION_US = 500; // Ticks further off are ignored
+
+enum SyncLineMode {
+  SYNC_LINE_OFF = 0,
+  SYNC_LINE_MASTER = 1,  // Drives the line
+  SYNC_LINE_FOLLOWER = 2 // Listens to the line
+};
+
+const uint8_t SYNC_LINE_PHASE_LOCK = 0x01; // Follower tracks the tick phase
+
+// Sync line sub-commands (CMD_SYNC_LINE)
+enum SyncLineCommand {
+  SYNC_LINE_SET_MODE = 0, // mode(1), flags(1)
+  SYNC_LINE_ARM_RUN = 1,  // programId(1), RUN_PLAYLIST_FLAG for a playlist
+  SYNC_LINE_ARM_MOVE = 2, // position(2), speedMs(4)
+  SYNC_LINE_DISARM = 3,
+  SYNC_LINE_QUERY = 4
+};
+
+enum SyncLineState {
+  SYNC_LINE_IDLE = 0,
+  SYNC_LINE_ARMED = 1,  // Follower waiting for the start edge
+  SYNC_LINE_RUNNING = 2 // Synced run in progress
+};
+
+struct SyncLineReport {
+  uint8_t mode;        // SyncLineMode
+  uint8_t flags;       // SYNC_LINE_PHASE_LOCK
+  uint8_t state;       // SyncLineState
+  uint16_t ticks;      // Ticks sent (master) or received (follower) last run
+  int16_t lastErrorUs; // Follower: last tick against its own timebase
+  uint16_t maxErrorUs; // Follower: worst tick error of the last run
+};
+
+// Set by the pin-change interrupt while a follower listens
+extern volatile bool syncListening;
+extern volatile uint32_t syncEdgeUs;
+extern volatile uint16_t syncEdges;
+extern volatile bool syncLineLow; // Level seen at the last pin change
+
+// Called from the PCINT0 interrupt, which the button and limit switch share:
+// only a high-to-low change of the sync line counts as an edge
+inline void syncPinChange() {
+  bool low = digitalRead(SYNC_PIN) == LOW;
+  if (syncListening && low && !syncLineLow) {
+    syncEdgeUs = micros();
+    syncEdges++;
+  }
+  syncLineLow = low;
+}
+
+// Function declarations
+void setupSyncLine();
+void handleSyncLineCommand(const char *data, int dataLen);
+void syncLineService();           // Call every loop() pass; starts armed runs
+int32_t syncTimebaseCorrection(); // Step engine: shift for the timebase, us
+
+#endif // SYNC_LINE_H
@@ -0,0 +1,479 @@
+#include "tmc_driver.h"
+
+#if FEATURE_TMC2209
+#include "command_processor.h"
+#include "motor_control.h"
+
+// Datagram framing
+const uint8_t TMC_SYNC = 0x05;
+const uint8_t TMC_MASTER = 0xFF; // Address in replies
+const uint8_t TMC_WRITE = 0x80;  // Register address flag for writes
+const uint8_t TMC_WRITE_BYTES = 8;
+const uint8_t TMC_READ_BYTES = 4;
+const uint8_t TMC_WRITE_MS = 2; // A write datagram is off the line by then
+
+// Register fields
+const uint32_t GCONF_I_SCALE_ANALOG = 1UL << 0; // VREF pot caps the current
+const uint32_t GCONF_EN_SPREADCYCLE = 1UL << 2;
+const uint32_t GCONF_PDN_DISABLE = 1UL << 6;      // PDN_UART pin is the UART
+const uint32_t GCONF_MSTEP_REG_SELECT = 1UL << 7; // MRES, not the MS pins
+const uint32_t GCONF_MULTISTEP_FILT = 1UL << 8;
+const uint32_t GSTAT_RESET = 0x01; // Driver was reset; write 1 to clear
+const uint32_t CHOPCONF_DEFAULT = 0x10000053UL; // intpol, TOFF 3, HSTRT 5
+const uint8_t CHOPCONF_MRES_SHIFT = 24;
+const uint32_t CHOPCONF_MRES_MASK = 0x0FUL << CHOPCONF_MRES_SHIFT;
+const uint32_t TPWMTHRS_MAX = 0xFFFFFUL;
+const uint32_t TMC_CLOCK_HZ = 12000000UL;
+
+const uint32_t DRV_OTPW = 1UL << 0;
+const uint32_t DRV_OT = 1UL << 1;
+const uint32_t DRV_SHORT = 0x3CUL; // s2ga, s2gb, s2vsa, s2vsb
+const uint32_t DRV_OPEN = 0xC0UL;  // ola, olb
+const uint8_t DRV_CS_SHIFT = 16;
+const uint32_t DRV_STEALTH = 1UL << 30;
+const uint32_t DRV_STST = 1UL << 31;
+
+// Configuration writes, in the order they are sent; bit n = entry n
+static const uint8_t writeOrder[] = {TMC_GCONF, TMC_CHOPCONF, TMC_IHOLD_IRUN,
+                                     TMC_TPWMTHRS, TMC_GSTAT};
+const uint8_t WRITE_CONFIG = 0x0F; // All but the GSTAT clear
+const uint8_t WRITE_GSTAT = 0x10;
+
+// Status reads, one per pass through the poll cycle. IFCNT goes first so
+// writes are confirmed before anything else is believed.
+static const uint8_t pollOrder[] = {TMC_IFCNT, TMC_GSTAT, TMC_DRV_STATUS,
+                                    TMC_SG_RESULT};
+
+enum DriverPhase {
+  PHASE_IDLE = 0,
+  PHASE_WRITING = 1, // Write datagram going out
+  PHASE_READING = 2  // Read request sent, waiting for the reply
+};
+
+static uint8_t mresFor(uint8_t microsteps) {
+  uint8_t mres = 8; // Full step
+  while (microsteps > 1 && mres > 0) {
+    microsteps >>= 1;
+    mres--;
+  }
+  return mres;
+}
+
+static DriverConfig settings;
+static uint8_t mres = mresFor(DEFAULT_MICROSTEPPING);
+
+static uint8_t phase = PHASE_IDLE;
+static uint8_t pendingWrites = 0;
+static bool rawPending = false;
+static uint8_t rawRegister = 0;
+static uint32_t rawValue = 0;
+static uint8_t readRegister = 0;
+static uint32_t sentMs = 0;
+static uint8_t reply[TMC_WRITE_BYTES]; // Last bytes received
+static uint8_t replyCount = 0;
+
+static uint8_t pollIndex = 0;
+static bool pollDue = true;
+static uint32_t pollStartMs = 0;
+static bool ifcntKnown = false;
+static uint8_t expectedIfcnt = 0;
+
+static uint8_t status = 0;
+static uint8_t reportedStatus = 0;
+static uint8_t current = 0;
+static uint16_t stallGuard = 0;
+static uint16_t errors = 0;
+
+// UART CRC8 (x^8 + x^2 + x + 1), bytes taken LSB first as in the datasheet
+static uint8_t datagramCrc(const uint8_t *bytes, uint8_t length) {
+  uint8_t crc = 0;
+  for (uint8_t i = 0; i < length; i++) {
+    uint8_t byte = bytes[i];
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      if ((crc >> 7) ^ (byte & 0x01)) {
+        crc = (crc << 1) ^ 0x07;
+      } else {
+        crc <<= 1;
+      }
+      byte >>= 1;
+    }
+  }
+  return crc;
+}
+
+#if TMC2209_SIMULATED
+// Register-level stand-in for a driver: parses the same datagrams, checks
+// their CRC, keeps the registers this module uses and answers reads. The
+// status registers follow the real step output, so current switching,
+// StealthChop/SpreadCycle changes and StallGuard can be watched with no
+// driver attached. Writing a status register sets its value (fault tests).
+static const uint8_t simAddresses[] = {
+    TMC_GCONF,    TMC_GSTAT,     TMC_IFCNT,    TMC_IHOLD_IRUN,
+    TMC_TPWMTHRS, TMC_SG_RESULT, TMC_CHOPCONF, TMC_DRV_STATUS};
+const uint8_t SIM_REGISTERS = sizeof(simAddresses);
+static uint32_t simValues[SIM_REGISTERS];
+static uint8_t simRequest[TMC_WRITE_BYTES];
+static uint8_t simRequestCount = 0;
+static uint8_t simReply[TMC_WRITE_BYTES];
+static uint8_t simReplyCount = 0;
+static uint8_t simReplyRead = 0;
+static long simLastPosition = 0;
+static uint32_t simLastMs = 0;
+
+static uint32_t *simRegister(uint8_t address) {
+  for (uint8_t i = 0; i < SIM_REGISTERS; i++) {
+    if (simAddresses[i] == address) {
+      return &simValues[i];
+    }
+  }
+  return nullptr;
+}
+
+// DRV_STATUS and SG_RESULT from the motion since the last status read
+static void simUpdateStatus() {
+  uint32_t now = millis();
+  long position = positionMicrosteps();
+  uint32_t moved = abs(position - simLastPosition);
+  uint32_t elapsedMs = max(now - simLastMs, 1UL);
+  uint32_t velocity = moved * 1000 / elapsedMs;
+  simLastPosition = position;
+  simLastMs = now;
+
+  uint32_t microsteps = 256UL >> ((*simRegister(TMC_CHOPCONF) &
+                                   CHOPCONF_MRES_MASK) >>
+                                  CHOPCONF_MRES_SHIFT);
+  uint32_t tstep = velocity ? TMC_CLOCK_HZ / 256 * microsteps / velocity
+                            : TPWMTHRS_MAX;
+  uint32_t threshold = *simRegister(TMC_TPWMTHRS);
+  bool stealth = !(*simRegister(TMC_GCONF) & GCONF_EN_SPREADCYCLE) &&
+                 (threshold == 0 || tstep >= threshold);
+  uint32_t currents = *simRegister(TMC_IHOLD_IRUN);
+  uint32_t cs = moved ? (currents >> 8) & 0x1F : currents & 0x1F;
+
+  uint32_t &drvStatus = *simRegister(TMC_DRV_STATUS);
+  drvStatus = (drvStatus & (DRV_OTPW | DRV_OT | DRV_SHORT | DRV_OPEN)) |
+              cs << DRV_CS_SHIFT | (stealth ? DRV_STEALTH : 0) |
+              (moved ? 0 : DRV_STST);
+  // Unloaded motor: the reading rises with speed
+  *simRegister(TMC_SG_RESULT) = stealth && moved ? min(velocity / 4, 510UL)
+                                                 : 0;
+}
+
+static void simAnswer(uint8_t address) {
+  uint32_t *value = simRegister(address);
+  if (!value) {
+    return; // Unused register: a real driver would answer, we stay silent
+  }
+  if (address == TMC_DRV_STATUS) {
+    simUpdateStatus();
+  }
+  simReply[0] = TMC_SYNC;
+  simReply[1] = TMC_MASTER;
+  simReply[2] = address;
+  for (uint8_t i = 0; i < 4; i++) {
+    simReply[3 + i] = *value >> (24 - 8 * i);
+  }
+  simReply[7] = datagramCrc(simReply, 7);
+  simReplyCount = TMC_WRITE_BYTES;
+  simReplyRead = 0;
+}
+
+static void simReceive(uint8_t byte) {
+  if (simRequestCount == 0 && byte != TMC_SYNC) {
+    return;
+  }
+  simRequest[simRequestCount++] = byte;
+  bool write = simRequestCount >= 3 && (simRequest[2] & TMC_WRITE);
+  uint8_t length = write ? TMC_WRITE_BYTES : TMC_READ_BYTES;
+  if (simRequestCount < length) {
+    return;
+  }
+  simRequestCount = 0;
+  if (simRequest[1] != TMC_ADDRESS ||
+      simRequest[length - 1] != datagramCrc(simRequest, length - 1)) {
+    return; // Ignored, exactly like the driver
+  }
+
+  uint8_t address = simRequest[2] & ~TMC_WRITE;
+  if (!write) {
+    simAnswer(address);
+    return;
+  }
+  uint32_t value = 0;
+  for (uint8_t i = 0; i < 4; i++) {
+    value = value << 8 | simRequest[3 + i];
+  }
+  uint32_t *stored = simRegister(address);
+  if (stored) {
+    *stored = address == TMC_GSTAT ? *stored & ~value : value;
+  }
+  (*simRegister(TMC_IFCNT))++;
+  *simRegister(TMC_IFCNT) &= 0xFF;
+}
+
+static void portBegin() {
+  *simRegister(TMC_GCONF) = GCONF_I_SCALE_ANALOG;
+  *simRegister(TMC_GSTAT) = GSTAT_RESET;
+  *simRegister(TMC_IHOLD_IRUN) = 0x00071F10UL;
+  *simRegister(TMC_CHOPCONF) = CHOPCONF_DEFAULT;
+  *simRegister(TMC_DRV_STATUS) = DRV_STST;
+}
+
+static void portWrite(const uint8_t *bytes, uint8_t length) {
+  for (uint8_t i = 0; i < length; i++) {
+    simReceive(bytes[i]);
+  }
+}
+
+static bool portAvailable() { return simReplyRead < simReplyCount; }
+
+static uint8_t portRead() { return simReply[simReplyRead++]; }
+#else
+static void portBegin() { Serial1.begin(TMC_BAUD); }
+
+static void portWrite(const uint8_t *bytes, uint8_t length) {
+  Serial1.write(bytes, length);
+}
+
+static bool portAvailable() { return Serial1.available() > 0; }
+
+static uint8_t portRead() { return Serial1.read(); }
+#endif
+
+static void sendDriverReport() {
+  DriverReport report;
+  report.status = status;
+  report.current = current;
+  report.stallGuard = stallGuard;
+  report.errors = errors;
+  report.config = settings;
+  reportedStatus = status;
+  sendReport(REPORT_DRIVER, (const uint8_t *)&report, sizeof(report));
+}
+
+// Report a fault or the driver coming and going without being asked
+static void reportFaultChange() {
+  if ((status ^ reportedStatus) & DRIVER_FAULTS) {
+    sendDriverReport();
+  }
+}
+
+// StealthChop while TSTEP (12MHz clocks per 1/256 microstep) stays at or
+// above this, i.e. up to stealthMaxVelocity microsteps/s
+static uint32_t stealthThreshold() {
+  if (settings.stealthMaxVelocity == 0) {
+    return 0;
+  }
+  uint32_t microsteps = 256UL >> mres;
+  return min(TMC_CLOCK_HZ / 256 * microsteps / settings.stealthMaxVelocity,
+             TPWMTHRS_MAX);
+}
+
+static uint32_t registerValue(uint8_t address) {
+  switch (address) {
+  case TMC_GCONF:
+    return GCONF_I_SCALE_ANALOG | GCONF_PDN_DISABLE | GCONF_MSTEP_REG_SELECT |
+           GCONF_MULTISTEP_FILT |
+           (settings.flags & DRIVER_FLAG_SPREADCYCLE ? GCONF_EN_SPREADCYCLE
+                                                     : 0);
+  case TMC_CHOPCONF:
+    return (CHOPCONF_DEFAULT & ~CHOPCONF_MRES_MASK) |
+           (uint32_t)mres << CHOPCONF_MRES_SHIFT;
+  case TMC_IHOLD_IRUN:
+    return (uint32_t)TMC_HOLD_DELAY << 16 | (uint32_t)settings.runCurrent << 8 |
+           settings.holdCurrent;
+  case TMC_TPWMTHRS:
+    return stealthThreshold();
+  default: // TMC_GSTAT
+    return GSTAT_RESET;
+  }
+}
+
+static void sendWrite(uint8_t address, uint32_t value) {
+  uint8_t datagram[TMC_WRITE_BYTES] = {TMC_SYNC, TMC_ADDRESS,
+                                       (uint8_t)(address | TMC_WRITE),
+                                       (uint8_t)(value >> 24),
+                                       (uint8_t)(value >> 16),
+                                       (uint8_t)(value >> 8), (uint8_t)value};
+  datagram[7] = datagramCrc(datagram, 7);
+  portWrite(datagram, TMC_WRITE_BYTES);
+  expectedIfcnt++;
+  phase = PHASE_WRITING;
+  sentMs = millis();
+
+  // Confirm through IFCNT before polling the status again
+  pollIndex = 0;
+  pollDue = true;
+}
+
+static void sendRead(uint8_t address) {
+  uint8_t datagram[TMC_READ_BYTES] = {TMC_SYNC, TMC_ADDRESS, address};
+  datagram[3] = datagramCrc(datagram, 3);
+  replyCount = 0;
+  readRegister = address;
+  portWrite(datagram, TMC_READ_BYTES);
+  phase = PHASE_READING;
+  sentMs = millis();
+}
+
+static void handleReply(uint32_t value) {
+  status |= DRIVER_ONLINE;
+
+  switch (readRegister) {
+  case TMC_IFCNT:
+    if (ifcntKnown && (uint8_t)value != expectedIfcnt) {
+      errors++;
+      pendingWrites |= WRITE_CONFIG; // A write was lost; send them again
+    }
+    expectedIfcnt = value;
+    ifcntKnown = true;
+    break;
+  case TMC_GSTAT:
+    if (value & GSTAT_RESET) {
+      pendingWrites |= WRITE_CONFIG | WRITE_GSTAT; // Power cycled
+    }
+    break;
+  case TMC_DRV_STATUS:
+    status &= DRIVER_ONLINE | DRIVER_SIMULATED;
+    status |= (value & DRV_STEALTH ? DRIVER_STEALTH : 0) |
+              (value & DRV_STST ? DRIVER_STANDSTILL : 0) |
+              (value & DRV_OTPW ? DRIVER_OT_WARNING : 0) |
+              (value & DRV_OT ? DRIVER_OVERTEMP : 0) |
+              (value & DRV_SHORT ? DRIVER_SHORT : 0) |
+              (value & DRV_OPEN ? DRIVER_OPEN_LOAD : 0);
+    current = (value >> DRV_CS_SHIFT) & 0x1F;
+    break;
+  case TMC_SG_RESULT:
+    stallGuard = value & 0x3FF;
+    break;
+  }
+  reportFaultChange();
+  pollIndex = (pollIndex + 1) % sizeof(pollOrder);
+}
+
+// Single-wire UART: our own request comes back first, so keep the last
+// eight bytes and accept them once they form a valid reply
+static void receiveByte(uint8_t byte) {
+  if (phase != PHASE_READING) {
+    return;
+  }
+  if (replyCount == TMC_WRITE_BYTES) {
+    memmove(reply, reply + 1, TMC_WRITE_BYTES - 1);
+    replyCount--;
+  }
+  reply[replyCount++] = byte;
+  if (replyCount < TMC_WRITE_BYTES || reply[0] != TMC_SYNC ||
+      reply[1] != TMC_MASTER || reply[2] != readRegister ||
+      reply[7] != datagramCrc(reply, 7)) {
+    return;
+  }
+
+  uint32_t value = 0;
+  for (uint8_t i = 0; i < 4; i++) {
+    value = value << 8 | reply[3 + i];
+  }
+  phase = PHASE_IDLE;
+  handleReply(value);
+}
+
+// No valid reply: assume the driver lost power and configure it again
+// once it answers
+static void readTimedOut() {
+  phase = PHASE_IDLE;
+  if (status & DRIVER_ONLINE) {
+    errors++;
+  }
+  status &= DRIVER_SIMULATED;
+  ifcntKnown = false;
+  pendingWrites |= WRITE_CONFIG;
+  pollIndex = 0;
+  reportFaultChange();
+}
+
+// Next datagram: pending writes first (only once IFCNT is known, so they
+// can be confirmed), then the status poll
+static void startNext() {
+  if (ifcntKnown) {
+    if (rawPending) {
+      rawPending = false;
+      sendWrite(rawRegister, rawValue);
+      return;
+    }
+    for (uint8_t i = 0; i < sizeof(writeOrder); i++) {
+      if (pendingWrites & (1 << i)) {
+        pendingWrites &= ~(1 << i);
+        sendWrite(writeOrder[i], registerValue(writeOrder[i]));
+        return;
+      }
+    }
+  }
+
+  uint32_t now = millis();
+  if (pollIndex == 0) {
+    if (!pollDue && now - pollStartMs < TMC_POLL_MS) {
+      return;
+    }
+    pollDue = false;
+    pollStartMs = now;
+  }
+  sendRead(pollOrder[pollIndex]);
+}
+
+void setupDriver() {
+  loadDriverConfig(&settings);
+  portBegin();
+#if TMC2209_SIMULATED
+  status = DRIVER_SIMULATED;
+  reportedStatus = status;
+#endif
+  pendingWrites = WRITE_CONFIG;
+}
+
+void driverService() {
+  while (portAvailable()) {
+    receiveByte(portRead());
+  }
+
+  uint32_t elapsed = millis() - sentMs;
+  if (phase == PHASE_WRITING) {
+    if (elapsed < TMC_WRITE_MS) {
+      return;
+    }
+    phase = PHASE_IDLE;
+  } else if (phase == PHASE_READING) {
+    if (elapsed <= TMC_REPLY_TIMEOUT_MS) {
+      return;
+    }
+    readTimedOut();
+  }
+  startNext();
+}
+
+// UART mode: resolution comes from CHOPCONF.MRES, interpolated to 1/256
+void driverSetMicrostepping(uint8_t microsteps) {
+  mres = mresFor(microsteps);
+  pendingWrites |= WRITE_CONFIG; // CHOPCONF, and TPWMTHRS scales with it
+}
+
+void handleDriverCommand(const char *data, int dataLen) {
+  uint8_t command = dataLen >= 1 ? (uint8_t)data[0] : DRIVER_QUERY;
+
+  switch (command) {
+  case DRIVER_CONFIGURE:
+    settings.runCurrent = min((uint8_t)data[1], (uint8_t)31);
+    settings.holdCurrent = min((uint8_t)data[2], (uint8_t)31);
+    settings.stealthMaxVelocity = *(uint16_t *)(data + 3);
+    settings.flags = data[5] & DRIVER_FLAG_SPREADCYCLE;
+    saveDriverConfig(settings);
+    pendingWrites |= WRITE_CONFIG;
+    break;
+  case DRIVER_WRITE:
+    rawRegister = data[1] & ~TMC_WRITE;
+    rawValue = *(uint32_t *)(data + 2);
+    rawPending = true;
+    break;
+  }
+  sendDriverReport();
+}
+
+#endif // FEATURE_TMC2209
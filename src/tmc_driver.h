@@ -0,0 +1,77 @@
+#ifndef TMC_DRIVER_H
+#define TMC_DRIVER_H
+
+#include <Arduino.h>
+
+#include "build_profile.h"
+#include "config_manager.h"
+
+// TMC2209 management over its single-wire UART (Serial1 TX through 1k to
+// PDN_UART, RX direct). Stepping stays on STEP/DIR; the UART only sets up
+// the driver and reads its status. Register traffic is a non-blocking state
+// machine run from loop() and the step engine's yield, one datagram at a
+// time, so it never delays a pulse. The driver switches between StealthChop
+// (silent) and SpreadCycle (full torque) by itself at the TPWMTHRS speed.
+const uint8_t TMC_ADDRESS = 0;         // MS1/MS2 strapping in UART mode
+const uint32_t TMC_BAUD = 115200;
+const uint8_t TMC_REPLY_TIMEOUT_MS = 5; // No reply: driver offline
+const uint16_t TMC_POLL_MS = 100;       // Status register read interval
+const uint8_t TMC_HOLD_DELAY = 8;       // IHOLDDELAY, run to hold ramp
+
+// Registers used
+enum TmcRegister {
+  TMC_GCONF = 0x00,
+  TMC_GSTAT = 0x01,
+  TMC_IFCNT = 0x02, // Counts valid writes; confirms they arrived
+  TMC_IHOLD_IRUN = 0x10,
+  TMC_TPWMTHRS = 0x13,
+  TMC_SG_RESULT = 0x41,
+  TMC_CHOPCONF = 0x6C,
+  TMC_DRV_STATUS = 0x6F
+};
+
+// Driver sub-commands (CMD_DRIVER)
+enum DriverCommand {
+  DRIVER_CONFIGURE = 0, // run(1), hold(1), stealthMaxVelocity(2), flags(1)
+  DRIVER_QUERY = 1,     // Report the status and settings
+  DRIVER_WRITE = 2      // register(1), value(4); diagnostics, not saved
+};
+
+// REPORT_DRIVER status bits
+const uint8_t DRIVER_ONLINE = 0x01;     // Driver answered the last read
+const uint8_t DRIVER_STEALTH = 0x02;    // Running in StealthChop
+const uint8_t DRIVER_STANDSTILL = 0x04; // No step for 2^20 clocks
+const uint8_t DRIVER_OT_WARNING = 0x08; // Over 120C
+const uint8_t DRIVER_OVERTEMP = 0x10;   // Shut down, over 150C
+const uint8_t DRIVER_SHORT = 0x20;      // Short to ground or supply
+const uint8_t DRIVER_OPEN_LOAD = 0x40;  // Coil A or B open at standstill
+const uint8_t DRIVER_SIMULATED = 0x80;  // Register model, no real driver
+
+// Bits whose change is reported without being asked for
+const uint8_t DRIVER_FAULTS = DRIVER_ONLINE | DRIVER_OT_WARNING |
+                              DRIVER_OVERTEMP | DRIVER_SHORT |
+                              DRIVER_OPEN_LOAD;
+
+struct DriverReport {
+  uint8_t status;      // DRIVER_* bits
+  uint8_t current;     // CS_ACTUAL, 0-31
+  uint16_t stallGuard; // SG_RESULT, lower = more load
+  uint16_t errors;     // Timeouts, bad replies and lost writes (wraps)
+  DriverConfig config; // Settings in use
+};
+
+#if FEATURE_TMC2209
+// Function declarations
+void setupDriver();
+void driverService(); // Call every loop() pass and from the motion yield
+void driverSetMicrostepping(uint8_t microsteps);
+void handleDriverCommand(const char *data, int dataLen);
+#else
+// Plain STEP/DIR: microstepping comes from the MS pins
+inline void setupDriver() {}
+inline void driverService() {}
+inline void driverSetMicrostepping(uint8_t microsteps) {}
+inline void handleDriverCommand(const char *data, int dataLen) {}
+#endif
+
+#endif // TMC_DRIVER_H
@@ -0,0 +1,46 @@
+#include "trace.h"
+#include "command_processor.h"
+
+static TraceRecord traceBuffer[TRACE_SIZE];
+static uint16_t traceTotal = 0;
+static uint32_t lastTraceMs = 0;
+
+static void store(uint32_t now, uint8_t event, uint8_t a, uint16_t b) {
+  TraceRecord &record = traceBuffer[traceTotal & (TRACE_SIZE - 1)];
+  record.ms = now;
+  record.event = event;
+  record.a = a;
+  record.b = b;
+  traceTotal++;
+}
+
+// Log an event: a handful of stores, cheap enough to leave in production
+void trace(uint8_t event, uint8_t a, uint16_t b) {
+  uint32_t now = millis();
+  uint32_t gap = now - lastTraceMs;
+  lastTraceMs = now;
+  if (gap > 0xFFFF && traceTotal > 0) {
+    store(now, TRACE_GAP, 0, min(gap >> 16, 0xFFFFUL));
+  }
+  store(now, event, a, b);
+}
+
+// Send the buffer as one REPORT_TRACE frame, oldest record first
+void sendTraceDump() {
+  uint8_t payload[sizeof(TraceDumpHeader) + sizeof(traceBuffer)];
+  TraceDumpHeader header;
+  header.nowMs = millis();
+  header.nowUs = micros();
+  header.total = traceTotal;
+  header.count = traceTotal < TRACE_SIZE ? traceTotal : TRACE_SIZE;
+  memcpy(payload, &header, sizeof(header));
+
+  uint16_t first = traceTotal - header.count;
+  for (uint8_t i = 0; i < header.count; i++) {
+    memcpy(payload + sizeof(header) + i * sizeof(TraceRecord),
+           &traceBuffer[(first + i) & (TRACE_SIZE - 1)], sizeof(TraceRecord));
+  }
+
+  sendReport(REPORT_TRACE, payload,
+             sizeof(header) + header.count * sizeof(TraceRecord));
+}
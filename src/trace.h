@@ -0,0 +1,68 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Arduino.h>
+
+// Always-on event trace: a RAM ring of compact binary records, overwritten
+// oldest first and dumped to the host on request (CMD_TRACE_DUMP). Logging
+// an event is a handful of stores, cheap enough to leave in production.
+const uint8_t TRACE_SIZE = 32; // Records kept (power of two)
+// Routine refreshes (~25ms at 400kHz) are not traced, only slower ones
+const uint16_t TRACE_SLOW_DISPLAY_US = 40000;
+
+// Event ids; args a/b per event noted alongside
+enum TraceEvent {
+  TRACE_COMMAND = 1,      // a = command code, b = payload length
+  TRACE_COMMAND_DONE = 2, // a = command code, b = handling time (ms)
+  TRACE_MOVE_START = 3,   // a = TraceMoveKind, b = position (steps)
+  TRACE_MOVE_END = 4,     // a = TraceMoveEnd, b = position (steps)
+  TRACE_PAUSE = 5,        // b = position (steps)
+  TRACE_RESUME = 6,       // b = position (steps)
+  TRACE_MENU_ENTER = 7,   // b = menu items
+  TRACE_MENU_EXIT = 8,
+  TRACE_DISPLAY = 9,      // b = flush time (us, saturated), slow ones only
+  TRACE_EEPROM_WRITE = 10, // a = length, b = address
+  TRACE_EEPROM_DONE = 11,  // a = EepromStatus, b = bytes written
+  TRACE_USB_CONNECT = 12,
+  TRACE_USB_TIMEOUT = 13, // b = ms since the last received data
+  TRACE_CUE = 14,         // a = command code, b = lateness (us, saturated)
+  TRACE_GAP = 15          // b = whole 65536ms wraps since the record before
+};
+
+enum TraceMoveKind {
+  TRACE_MOVE_RUN = 0,  // Single run of microsteps
+  TRACE_MOVE_QUEUE = 1, // Planned segment queue (programs, playback)
+  TRACE_MOVE_PVT = 2    // Host-streamed PVT path
+};
+
+enum TraceMoveEnd {
+  TRACE_END_DONE = 0,
+  TRACE_END_PAUSED = 1,
+  TRACE_END_STOPPED = 2,
+  TRACE_END_HALTED = 3 // External stop flag (limit switch)
+};
+
+// Record times are the low 16 bits of millis(). Before a record more than
+// 65.5s after the previous one, a TRACE_GAP record carries the wraps in
+// between, so the host can still walk back from the dump time.
+struct TraceRecord {
+  uint16_t ms;  // millis(), low 16 bits
+  uint8_t event; // TraceEvent
+  uint8_t a;
+  uint16_t b;
+};
+
+// REPORT_TRACE payload: this header, then up to TRACE_SIZE records, oldest
+// first. Record times are relative to nowMs modulo 65536.
+struct TraceDumpHeader {
+  uint32_t nowMs; // millis() when the dump was taken
+  uint32_t nowUs; // micros() at the same moment, for host clock translation
+  uint16_t total; // Events logged since boot (wraps)
+  uint8_t count;  // Records that follow
+};
+
+// Function declarations
+void trace(uint8_t event, uint8_t a = 0, uint16_t b = 0); // Foreground only
+void sendTraceDump();
+
+#endif // TRACE_H
@@ -0,0 +1,206 @@
+#include "trajectory.h"
+#include "command_processor.h"
+#include "jog_control.h"
+#include "motor_control.h"
+#include "trace.h"
+
+const uint32_t SLICE_US = PVT_SLICE_MS * 1000UL;
+// Speed cap: no more microsteps per slice than jog mode allows
+const uint16_t MAX_SLICE_STEPS =
+    (uint32_t)JOG_MAX_VELOCITY * PVT_SLICE_MS / 1000;
+
+// Knot ring; the oldest knot is the end of the segment in progress
+static PvtKnot knots[PVT_BUFFER_SIZE];
+static uint8_t knotTail = 0;
+static uint8_t knotCount = 0;
+static uint16_t consumed = 0;
+static bool running = false;
+static bool lowReported = false;
+
+// Start of the segment in progress, and the time into it at the slice end
+static int32_t fromPosition = 0;
+static int16_t fromVelocity = 0;
+static uint16_t segmentMs = 0;
+
+// Slice being stepped out: sliceSteps pulses spread evenly over SLICE_US
+static uint32_t sliceStartUs = 0;
+static uint32_t stepPeriodUs = 0;
+static uint16_t sliceSteps = 0;
+static uint16_t sliceIssued = 0;
+static bool sliceDirection = true;
+
+static void sendPvtReport(uint8_t status, uint8_t dropped = 0) {
+  PvtReport report;
+  report.status = status;
+  report.buffered = knotCount;
+  report.free = PVT_BUFFER_SIZE - knotCount;
+  report.dropped = dropped;
+  report.consumed = consumed;
+  report.position = positionMicrosteps();
+  sendReport(REPORT_PVT, (const uint8_t *)&report, sizeof(report));
+}
+
+// Position t ms into the segment ending at knot `to`. Hermite basis in Q16;
+// u < 1 because the segment is advanced once t reaches its duration.
+static int32_t hermitePosition(const PvtKnot &to, uint16_t t) {
+  uint32_t u = ((uint32_t)t << 16) / to.durationMs;
+  uint32_t u2 = (u * u) >> 16;
+  uint32_t u3 = (u2 * u) >> 16;
+  int32_t h01 = 3 * (int32_t)u2 - 2 * (int32_t)u3;
+  int32_t h10 = (int32_t)u3 - 2 * (int32_t)u2 + (int32_t)u;
+  int32_t h11 = (int32_t)u3 - (int32_t)u2;
+
+  // End tangents scaled to the segment length, in microsteps
+  int32_t m0 = (int32_t)fromVelocity * to.durationMs / 1000;
+  int32_t m1 = (int32_t)to.velocity * to.durationMs / 1000;
+
+  int64_t blend = (int64_t)(to.position - fromPosition) * h01 +
+                  (int64_t)m0 * h10 + (int64_t)m1 * h11;
+  return fromPosition + (int32_t)((blend + 0x8000) >> 16);
+}
+
+// Advance path time by the given slices and plan the microsteps that reach
+// the curve at the slice end. Steps still owed from a late slice are folded
+// in; only the step rate is capped.
+static void planSlice(uint16_t slices = 1) {
+  int32_t target = fromPosition;
+
+  if (knotCount > 0) {
+    segmentMs += slices * PVT_SLICE_MS;
+    while (knotCount > 0 && segmentMs >= knots[knotTail].durationMs) {
+      const PvtKnot &reached = knots[knotTail];
+      segmentMs -= reached.durationMs;
+      fromPosition = reached.position;
+      fromVelocity = reached.velocity;
+      knotTail = (knotTail + 1) & (PVT_BUFFER_SIZE - 1);
+      knotCount--;
+      consumed++;
+    }
+    target = knotCount > 0 ? hermitePosition(knots[knotTail], segmentMs)
+                           : fromPosition;
+
+    if (knotCount <= PVT_LOW_WATER && !lowReported) {
+      lowReported = true;
+      sendPvtReport(PVT_LOW);
+    }
+  }
+
+  long delta = target - positionMicrosteps();
+  sliceDirection = delta > 0;
+  sliceSteps = min((unsigned long)abs(delta), (unsigned long)MAX_SLICE_STEPS);
+  sliceIssued = 0;
+  stepPeriodUs = sliceSteps ? SLICE_US / sliceSteps : 0;
+}
+
+static void stopPath(uint8_t status) {
+  running = false;
+  knotCount = 0;
+  uint8_t reason = status == PVT_STOPPED ? TRACE_END_STOPPED : TRACE_END_DONE;
+  trace(TRACE_MOVE_END, reason, currentPosition);
+  sendPvtReport(status);
+}
+
+static void appendKnots(const char *data, int dataLen) {
+  uint8_t count = dataLen >= 2 ? (uint8_t)data[1] : 0;
+  count = min(count, PVT_KNOTS_PER_COMMAND);
+
+  uint8_t stored = 0;
+  while (stored < count && knotCount < PVT_BUFFER_SIZE) {
+    PvtKnot &knot = knots[(knotTail + knotCount) & (PVT_BUFFER_SIZE - 1)];
+    memcpy(&knot, data + 2 + stored * sizeof(PvtKnot), sizeof(PvtKnot));
+    if (knot.durationMs == 0) {
+      knot.durationMs = 1;
+    }
+    knotCount++;
+    stored++;
+  }
+
+  if (knotCount > PVT_LOW_WATER) {
+    lowReported = false;
+  }
+  if (stored < count) {
+    sendPvtReport(PVT_OVERFLOW, count - stored);
+  }
+}
+
+static void startPath() {
+  if (running || knotCount == 0) {
+    sendPvtReport(running ? PVT_RUNNING : PVT_IDLE);
+    return;
+  }
+
+  jogHalt();
+  fromPosition = positionMicrosteps();
+  fromVelocity = 0;
+  segmentMs = 0;
+  consumed = 0;
+  lowReported = false;
+  running = true;
+  trace(TRACE_MOVE_START, TRACE_MOVE_PVT, currentPosition);
+
+  sliceStartUs = micros();
+  planSlice();
+}
+
+void handlePvtCommand(const char *data, int dataLen) {
+  uint8_t command = dataLen >= 1 ? (uint8_t)data[0] : PVT_QUERY;
+
+  switch (command) {
+  case PVT_APPEND:
+    appendKnots(data, dataLen);
+    break;
+  case PVT_START:
+    startPath();
+    break;
+  case PVT_STOP:
+    if (running) {
+      stopPath(PVT_STOPPED);
+    } else {
+      knotCount = 0;
+      sendPvtReport(PVT_IDLE);
+    }
+    break;
+  default:
+    sendPvtReport(running ? PVT_RUNNING : PVT_IDLE);
+    break;
+  }
+}
+
+void pvtService() {
+  if (!running) {
+    return;
+  }
+
+  uint32_t elapsed = micros() - sliceStartUs;
+
+  // Next microstep of this slice, one per pass so a stall never bursts
+  if (sliceIssued < sliceSteps &&
+      elapsed >= (uint32_t)(sliceIssued + 1) * stepPeriodUs) {
+    pulseStep(sliceDirection);
+    sliceIssued++;
+  }
+
+  if (elapsed < SLICE_US) {
+    return;
+  }
+
+  // Slice over: finish at the last knot, or plan the next one
+  if (knotCount == 0 && positionMicrosteps() == fromPosition) {
+    stopPath(fromVelocity != 0 ? PVT_UNDERRUN : PVT_DONE);
+    return;
+  }
+  // Path time stays on the absolute slice grid: after a stall, skip to the
+  // slice now in progress so the rest of the path is not left late
+  uint16_t slices = min(elapsed / SLICE_US, 1000UL);
+  sliceStartUs += slices * SLICE_US;
+  planSlice(slices);
+}
+
+bool pvtActive() { return running; }
+
+void pvtHalt() {
+  if (running) {
+    stopPath(PVT_STOPPED);
+  }
+  knotCount = 0;
+}
@@ -0,0 +1,57 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <Arduino.h>
+
+// Host-streamed PVT paths. The host sends sparse knots (position, velocity,
+// time since the previous knot); the firmware joins them with cubic Hermite
+// segments in fixed point, evaluates the curve every PVT_SLICE_MS and spreads
+// each slice's microsteps evenly across it. Like jog mode this runs from
+// loop(), so more knots can arrive while the path plays.
+const uint8_t PVT_BUFFER_SIZE = 16;      // Knots held (power of two)
+const uint8_t PVT_LOW_WATER = 4;         // Report once this few remain
+const uint8_t PVT_SLICE_MS = 5;          // Interpolation interval
+const uint8_t PVT_KNOTS_PER_COMMAND = 5; // Knots in one PVT_APPEND
+
+// PVT sub-commands (CMD_PVT)
+enum PvtCommand {
+  PVT_APPEND = 0, // count(1), count x knot(8)
+  PVT_START = 1,  // Play the buffered knots from the current position
+  PVT_STOP = 2,   // Stop now and drop the buffered knots
+  PVT_QUERY = 3   // Report the buffer state
+};
+
+// Path knot, reached durationMs after the previous knot (or the start)
+struct PvtKnot {
+  int32_t position;    // Microsteps from home
+  int16_t velocity;    // Microsteps/s on arrival
+  uint16_t durationMs; // Segment length, at least 1
+};
+
+// REPORT_PVT status
+enum PvtStatus {
+  PVT_IDLE = 0,     // Not playing
+  PVT_RUNNING = 1,  // Playing
+  PVT_LOW = 2,      // Buffer down to PVT_LOW_WATER; send more knots
+  PVT_DONE = 3,     // Last knot reached
+  PVT_UNDERRUN = 4, // Knots ran out while moving; stopped at the last one
+  PVT_OVERFLOW = 5, // Appended knots did not fit; see dropped
+  PVT_STOPPED = 6   // Stopped by the host or another move
+};
+
+struct PvtReport {
+  uint8_t status;    // PvtStatus
+  uint8_t buffered;  // Knots not yet reached
+  uint8_t free;      // Room for this many more
+  uint8_t dropped;   // Knots rejected from the end of the last append
+  uint16_t consumed; // Knots reached since PVT_START (wraps)
+  int32_t position;  // Microsteps
+};
+
+// Function declarations
+void handlePvtCommand(const char *data, int dataLen);
+void pvtService(); // Call every loop() pass; emits due steps
+bool pvtActive();  // Path playing
+void pvtHalt();    // Stop immediately and drop the buffer
+
+#endif // TRAJECTORY_H
@@ -1,16 +1,33 @@
+#include "src/build_profile.h"
+
+#include <EEPROM.h>
+#if FEATURE_DISPLAY
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
-#include <EEPROM.h>
-#include <WebUSB.h>
 #include <Wire.h>
+#endif
+#if FEATURE_USB
+#include <WebUSB.h>
+#endif
 
 // Include our modular headers
+#include "src/clock_sync.h"
 #include "src/command_processor.h"
 #include "src/config_manager.h"
 #include "src/display_manager.h"
+#include "src/eeprom_queue.h"
+#include "src/homing.h"
+#include "src/jog_control.h"
 #include "src/menu_system.h"
 #include "src/motor_control.h"
+#include "src/power_manager.h"
+#include "src/recorder.h"
+#include "src/sync_line.h"
+#include "src/tmc_driver.h"
+#include "src/trace.h"
+#include "src/trajectory.h"
 
+#if FEATURE_USB
 /**
  * Creating an instance of WebUSBSerial will add an additional USB interface to
  * the device that is marked as vendor-specific (rather than USB CDC-ACM) and
@@ -22,6 +39,7 @@
 WebUSB WebUSBSerial(1 /* https:// */, "localhost:8000");
 
 #define Serial WebUSBSerial
+#endif
 
 // Global variables
 long currentPosition = 0;
@@ -43,6 +61,7 @@ bool wasInProgrammingMode = false;
 bool programRunning = false;
 bool programPaused = false;
 
+#if FEATURE_TEXT_PROTOCOL
 // Function to send all EEPROM data immediately on connection
 void sendAllEEPROMData() {
   // Count valid programs (only loop programs)
@@ -85,10 +104,20 @@ void sendAllEEPROMData() {
   }
   Serial.flush();
 }
+#endif
+
+// Work kept going while a blocking move runs
+void motionYield() {
+  checkButton();
+  driverService();
+  scheduleServiceInRun();
+}
 
 void setup() {
+#if FEATURE_USB
   // Always start Serial for WebUSB
   Serial.begin(9600);
+#endif
   bootTime = millis();
   programmingMode =
       false; // Start in standalone mode, will switch if WebUSB connects
@@ -97,11 +126,15 @@ void setup() {
   setupMotorPins();
   setupButton();
   setupDisplay();
+  setupPower();
+  setupHoming();
+  setupSyncLine();
 
   // Set yield callback for motor control
-  setYieldCallback(checkButton);
+  setYieldCallback(motionYield);
 
   loadConfig();
+  setupDriver();
 
   // Build menu items based on stored programs
   buildMenuItems();
@@ -111,6 +144,7 @@ void setup() {
 }
 
 void loop() {
+#if FEATURE_USB
   // Check for WebUSB connection during boot period
   if (!serialCheckComplete) {
     if (Serial && (millis() - bootTime < serialWaitTime)) {
@@ -138,9 +172,12 @@ void loop() {
       exitMenuMode();
     }
 
+    trace(TRACE_USB_CONNECT);
+#if FEATURE_TEXT_PROTOCOL
     Serial.println("WebUSB Connected");
     delay(100); // Brief stabilization delay
     sendAllEEPROMData();
+#endif
   }
 
   // Detect WebUSB disconnection
@@ -148,6 +185,7 @@ void loop() {
     // Check if we haven't received any data for a while
     if (millis() - lastWebUSBActivity > webUSBTimeoutMs) {
       // WebUSB seems to be disconnected
+      trace(TRACE_USB_TIMEOUT, 0, min(millis() - lastWebUSBActivity, 0xFFFFUL));
       programmingMode = false;
       wasInProgrammingMode = false;
       // Enter menu mode automatically
@@ -157,45 +195,75 @@ void loop() {
       updateDisplay(); // Update display to show new mode
     }
   }
+#else
+  // No host link: go straight to the standalone menu
+  if (!serialCheckComplete) {
+    serialCheckComplete = true;
+    enterMenuMode();
+  }
+#endif
+
+  // Wake sources recorded since the last pass
+  uint8_t wake = takeWakeFlags();
 
-  // Check button state (with debouncing)
-  if (!programmingMode) {
+  // Report finished background EEPROM writes
+  eepromQueueService();
+
+  // Check button state (with debouncing) only after an edge or mid-press
+  if (!programmingMode && ((wake & WAKE_PIN_CHANGE) || buttonBusy())) {
     checkButton();
   }
 
-  // Update display periodically
-  if (millis() - lastDisplayUpdate > DISPLAY_UPDATE_INTERVAL) {
+  // Emit due jog steps (streamed velocity mode)
+  jogService();
+
+  // Emit due steps of a streamed PVT path
+  pvtService();
+
+  // Start an armed synced run once the start edge arrives
+  syncLineService();
+
+  // Sample the position for a recording in progress
+  recorderService();
+
+  // Driver register traffic and status polling
+  driverService();
+
+  // Run scheduled commands once due
+  scheduleService();
+
+  // Update display periodically, but not just before a scheduled command
+  // or while jog/path steps are due: the flush stalls the loop for ms
+  if (millis() - lastDisplayUpdate > DISPLAY_UPDATE_INTERVAL &&
+      !scheduleImminent() && !jogActive() && !pvtActive()) {
     updateDisplay();
     lastDisplayUpdate = millis();
   }
 
+  // Continue a paused run once resumed, or forget it once stopped
+  if (motionPaused() && !programPaused) {
+    if (programRunning) {
+      resumePausedRun();
+    } else {
+      dropPausedRun();
+    }
+  }
+
+#if FEATURE_USB
   if (programmingMode && Serial && Serial.available()) {
     // Update activity timestamp when we receive data
     lastWebUSBActivity = millis();
 
-    // Check if this is a binary command (first byte < 20)
-    uint8_t firstByte = Serial.peek();
-
-    if (firstByte < 20) {
-      // Binary command - read command code
-      uint8_t cmdCode = Serial.read();
-
-      // Read all available data as binary payload
-      uint8_t data[64];
-      int dataLen = 0;
-      delay(1); // Small delay to ensure all data is available
-
-      while (Serial.available() && dataLen < sizeof(data)) {
-        data[dataLen++] = Serial.read();
-      }
-
-      // Process the binary command
-      processCommandCode(cmdCode, (char *)data, dataLen);
-    }
-  } else if (!programmingMode && programRunning) {
+    // Run every complete binary command received so far
+    processCommandInput();
+  } else
+#endif
+  if (!programmingMode && programRunning) {
     executeStoredProgram();
-  } else {
-    // Program stopped, just idle
-    delay(50);
+  } else if (jogActive() || pvtActive()) {
+    // Jog or path steps are due at any moment; stay awake
+  } else if (!buttonBusy()) {
+    // Nothing pending: sleep until USB data, a pin change or the next tick
+    idleSleep();
   }
 }
@@ -11,6 +11,102 @@ class SliderController {
     this.CMD_LOOP_PROGRAM = 9;
     this.CMD_DEBUG_INFO = 14; // Request debug information
     this.CMD_POS_WITH_SPEED = 15; // Position with custom speed (handles both move and home)
+    this.CMD_SELF_TEST = 17; // Step rate sweep, answered with a binary report
+    this.CMD_PROGRAM_SYNC = 18; // Batch program sync transaction
+    this.CMD_PLAYLIST = 19; // Store a playlist
+    this.CMD_JOG = 20; // Velocity setpoint for jog mode
+    this.CMD_RECORD = 21; // Record/play back jogged moves
+    this.CMD_TRACE_DUMP = 22; // Send the event trace ring
+    this.CMD_HOMING = 23; // Limit-switch homing
+    this.CMD_PVT = 24; // Stream PVT path knots
+    this.CMD_SYNC_LINE = 25; // Multi-unit sync line
+    this.CMD_DRIVER = 26; // TMC2209 settings and status
+    this.CMD_CLOCK_SYNC = 27; // Clock sync exchange
+    this.CMD_SCHEDULE = 28; // Run a command at a set device time
+    this.MICROSTEPPING = 8; // DEFAULT_MICROSTEPPING in the firmware
+    this.JOG_STREAM_MS = 20; // Setpoint rate (50 Hz), well inside the 250ms deadman
+    this.jogTimer = null;
+    this.RUN_PLAYLIST_FLAG = 0x80; // CMD_RUN id bit selecting a playlist
+    this.MAX_PLAYLIST_ENTRIES = 6;
+
+    // Recording sub-commands
+    this.RECORD_START = 0;
+    this.RECORD_STOP = 1;
+    this.RECORD_PLAY = 2;
+    this.recording = false;
+
+    // Homing sub-commands
+    this.HOMING_RUN = 0;
+    this.HOMING_CONFIGURE = 1;
+    this.HOMING_QUERY = 2;
+
+    // PVT path sub-commands and knot buffer (src/trajectory.h)
+    this.PVT_APPEND = 0;
+    this.PVT_START = 1;
+    this.PVT_STOP = 2;
+    this.PVT_BUFFER_SIZE = 16;
+    this.PVT_KNOTS_PER_COMMAND = 5;
+    this.pathPending = []; // Knots not yet sent
+    this.pathRunning = false;
+    this.pathLastBatch = [];
+
+    // Sync line sub-commands (src/sync_line.h)
+    this.SYNC_LINE_SET_MODE = 0;
+    this.SYNC_LINE_ARM_RUN = 1;
+    this.SYNC_LINE_ARM_MOVE = 2;
+    this.SYNC_LINE_DISARM = 3;
+
+    // Driver sub-commands (src/tmc_driver.h)
+    this.DRIVER_CONFIGURE = 0;
+    this.DRIVER_QUERY = 1;
+
+    // Clock sync and scheduled commands (src/clock_sync.h)
+    this.SCHEDULE_ADD = 0;
+    this.SCHEDULE_CLEAR = 1;
+    this.SCHEDULE_PAYLOAD = 10;
+    this.SCHEDULE_HORIZON_MS = 1800000;
+    this.CLOCK_SAMPLES = 128; // Exchanges kept for the fit (about 4 minutes)
+    this.CLOCK_BURST = 8; // Exchanges sent right after connecting
+    this.CLOCK_MIN_SPAN_MS = 10000; // Less history than this: assume no drift
+    this.nextCue = 0;
+    this.resetClock();
+
+    // Program sync sub-commands
+    this.SYNC_MANIFEST = 0;
+    this.SYNC_SLOT = 1;
+    this.SYNC_COMMIT = 2;
+    this.MAX_PROGRAMS = 5;
+
+    // Binary report frames: magic(1), type(1), length(1), payload(length)
+    this.REPORT_SELF_TEST = 1;
+    this.REPORT_EEPROM = 2;
+    this.REPORT_SYNC = 3;
+    this.REPORT_RECORDING = 4;
+    this.REPORT_TRACE = 5;
+    this.REPORT_HOMING = 6;
+    this.REPORT_PVT = 7;
+    this.REPORT_SYNC_LINE = 8;
+    this.REPORT_DRIVER = 9;
+    this.REPORT_CLOCK = 10;
+    this.REPORT_SCHEDULE = 11;
+
+    // Payload bytes per command code (commandPayloadLength() in the firmware)
+    this.PAYLOAD_LENGTHS = {
+      [this.CMD_RUN]: 1,
+      [this.CMD_LOOP_PROGRAM]: 15,
+      [this.CMD_POS_WITH_SPEED]: 6,
+      [this.CMD_SELF_TEST]: 3,
+      [this.CMD_PROGRAM_SYNC]: 16,
+      [this.CMD_PLAYLIST]: 35,
+      [this.CMD_JOG]: 4,
+      [this.CMD_RECORD]: 3,
+      [this.CMD_HOMING]: 10,
+      [this.CMD_PVT]: 42,
+      [this.CMD_SYNC_LINE]: 7,
+      [this.CMD_DRIVER]: 6,
+      [this.CMD_CLOCK_SYNC]: 4,
+      [this.CMD_SCHEDULE]: 17,
+    };
 
     this.init();
   }
@@ -58,6 +154,67 @@ class SliderController {
     document
       .getElementById("moveBtn")
       .addEventListener("click", () => this.handleMove());
+    const jogSlider = document.getElementById("jogSlider");
+    jogSlider.addEventListener("pointerdown", () => this.startJog());
+    jogSlider.addEventListener("pointerup", () => this.stopJog());
+    jogSlider.addEventListener("pointercancel", () => this.stopJog());
+    jogSlider.addEventListener("blur", () => this.stopJog());
+    document
+      .getElementById("limitHomeBtn")
+      .addEventListener("click", () =>
+        this.sendCommand(this.CMD_HOMING, new Uint8Array([this.HOMING_RUN]))
+      );
+    document
+      .getElementById("saveHomingBtn")
+      .addEventListener("click", () => this.saveHomingSettings());
+    document
+      .getElementById("recordBtn")
+      .addEventListener("click", () => this.toggleRecording());
+    document
+      .getElementById("playRecordingBtn")
+      .addEventListener("click", () => this.playRecording());
+    document
+      .getElementById("runPathBtn")
+      .addEventListener("click", () => this.runPath());
+    document
+      .getElementById("syncModeBtn")
+      .addEventListener("click", () => this.setSyncLineMode());
+    document
+      .getElementById("syncArmMoveBtn")
+      .addEventListener("click", () => this.armSyncedMove());
+    document
+      .getElementById("syncArmProgramBtn")
+      .addEventListener("click", () => this.armSyncedProgram());
+    document
+      .getElementById("syncDisarmBtn")
+      .addEventListener("click", () =>
+        this.sendCommand(this.CMD_SYNC_LINE, new Uint8Array([this.SYNC_LINE_DISARM]))
+      );
+    document
+      .getElementById("cueMoveBtn")
+      .addEventListener("click", () => this.cueMove());
+    document
+      .getElementById("cueProgramBtn")
+      .addEventListener("click", () => this.cueProgram());
+    document
+      .getElementById("cueCancelBtn")
+      .addEventListener("click", () =>
+        this.sendCommand(this.CMD_SCHEDULE, new Uint8Array([this.SCHEDULE_CLEAR]))
+      );
+    document
+      .getElementById("saveDriverBtn")
+      .addEventListener("click", () => this.saveDriverSettings());
+    document
+      .getElementById("driverStatusBtn")
+      .addEventListener("click", () =>
+        this.sendCommand(this.CMD_DRIVER, new Uint8Array([this.DRIVER_QUERY]))
+      );
+    document
+      .getElementById("traceBtn")
+      .addEventListener("click", () => this.sendCommand(this.CMD_TRACE_DUMP));
+    document
+      .getElementById("selfTestBtn")
+      .addEventListener("click", () => this.runSelfTest());
 
     // Program builder - loop programs only
     document
@@ -66,6 +223,17 @@ class SliderController {
     document
       .getElementById("testProgram")
       .addEventListener("click", () => this.testProgram());
+    document
+      .getElementById("syncPrograms")
+      .addEventListener("click", () => this.syncLibrary());
+
+    // Playlists
+    document
+      .getElementById("savePlaylist")
+      .addEventListener("click", () => this.savePlaylist());
+    document
+      .getElementById("runPlaylist")
+      .addEventListener("click", () => this.runPlaylist());
 
     // Initialize program storage - loop programs only
     this.programNames = {}; // Store program names locally
@@ -129,6 +297,13 @@ class SliderController {
       this.updateConnectionStatus(true);
       this.log("Connected to slider controller");
 
+      // Fit the device clock: a quick burst now, then one exchange with
+      // every connection check
+      this.resetClock();
+      for (let i = 0; i < this.CLOCK_BURST; i++) {
+        setTimeout(() => this.sendClockSync(), 1000 + i * 250);
+      }
+
       // EEPROM data will be sent automatically by Arduino on connection
       // No need to request it
     } catch (error) {
@@ -188,10 +363,15 @@ class SliderController {
 
   setupDataListener() {
     // WebUSB serial interface data reception
-    this.port.onReceive = (data) => {
-      console.log("Received data:", data);
-      this.handleIncomingData(data);
-    };
+    // Split the stream into binary reports and text lines as it arrives
+    const decoder = new serial.FrameDecoder(
+      (type, view) => this.handleReport(type, view),
+      (line) => {
+        this.log(line);
+        this.processTextData(line);
+      }
+    );
+    this.port.onReceive = (data) => decoder.push(data);
 
     this.port.onReceiveError = (error) => {
       console.error("Receive error:", error);
@@ -207,69 +387,10 @@ class SliderController {
     // Set up periodic connection check
     this.connectionCheckInterval = setInterval(() => {
       this.checkConnection();
+      this.sendClockSync();
     }, 2000); // Check every 2 seconds
   }
 
-  handleIncomingData(data) {
-    // Handle WebUSB serial interface data (DataView/ArrayBuffer)
-    let textData;
-    let isBinary = false;
-
-    if (data instanceof DataView || data instanceof ArrayBuffer) {
-      // Convert to Uint8Array for processing
-      const uint8Data = new Uint8Array(
-        data instanceof ArrayBuffer ? data : data.buffer
-      );
-
-      // Improved binary detection for bulk EEPROM data:
-      // 1. Must be substantial size (bulk data is much larger than text messages)
-      // 2. First byte should be reasonable program count (0-10)
-      // 3. Should not be printable text throughout
-      const firstByte = uint8Data[0];
-
-      if (uint8Data.length > 20) {
-        // Check if this could be bulk EEPROM data
-        // Program count should be reasonable (0-10)
-        const seemsLikeProgramCount = firstByte >= 0 && firstByte <= 10;
-
-        // Check if it contains mostly non-printable or structured binary data
-        // Look at a few bytes to see if it has the binary structure we expect
-        let nonPrintableCount = 0;
-        const sampleSize = Math.min(20, uint8Data.length);
-        for (let i = 0; i < sampleSize; i++) {
-          if (uint8Data[i] < 32 && uint8Data[i] !== 10 && uint8Data[i] !== 13) {
-            nonPrintableCount++;
-          }
-        }
-
-        // If it starts with reasonable program count and has binary characteristics
-        if (
-          seemsLikeProgramCount &&
-          (nonPrintableCount > sampleSize * 0.3 || uint8Data.length > 100)
-        ) {
-          isBinary = true;
-          this.handleBinaryData(uint8Data);
-          return;
-        }
-      }
-
-      // Convert to string for text processing
-      const decoder = new TextDecoder();
-      textData = decoder.decode(uint8Data);
-    } else {
-      textData = data;
-    }
-
-    // Process text data line by line
-    const lines = textData.split("\n");
-    for (const line of lines) {
-      if (line.trim()) {
-        this.log(line.trim());
-        this.processTextData(line.trim());
-      }
-    }
-  }
-
   processTextData(data) {
     // Handle program count
     if (data.startsWith("PROGRAMS:")) {
@@ -341,155 +462,153 @@ class SliderController {
     }
   }
 
-  handleBinaryData(data) {
-    if (data.length < 2) return;
-
-    // data is already a Uint8Array, no conversion needed
-    const bytes = data;
-
-    // Check if this is bulk data (much longer than individual programs)
-    if (data.length > 50) {
-      this.handleBulkData(bytes);
-      return;
-    }
-
-    const programId = bytes[0];
-    this.log(`Received binary data for program ${programId}`);
-
-    // Check if this is loop program data (15 bytes expected for loop programs without cycles)
-    if (data.length === 15) {
-      // 15 bytes (no cycles)
-      this.handleLoopProgramBinary(bytes);
+  handleReport(type, view) {
+    if (type === this.REPORT_SELF_TEST) {
+      this.handleSelfTestReport(view);
+    } else if (type === this.REPORT_EEPROM) {
+      this.handleEepromReport(view);
+    } else if (type === this.REPORT_SYNC) {
+      this.handleSyncReport(view);
+    } else if (type === this.REPORT_RECORDING) {
+      this.handleRecordingReport(view);
+    } else if (type === this.REPORT_TRACE) {
+      this.handleTraceReport(view);
+    } else if (type === this.REPORT_HOMING) {
+      this.handleHomingReport(view);
+    } else if (type === this.REPORT_PVT) {
+      this.handlePathReport(view);
+    } else if (type === this.REPORT_SYNC_LINE) {
+      this.handleSyncLineReport(view);
+    } else if (type === this.REPORT_DRIVER) {
+      this.handleDriverReport(view);
+    } else if (type === this.REPORT_CLOCK) {
+      this.handleClockReport(view);
+    } else if (type === this.REPORT_SCHEDULE) {
+      this.handleScheduleReport(view);
+    } else {
+      this.log(`WARNING: Unknown report type ${type}`);
     }
   }
 
-  handleLoopProgramBinary(bytes) {
-    const programId = bytes[0];
+  handleEepromReport(view) {
+    // failAddr(2), written(2), skipped(2), status(1)
+    const failAddr = view.getUint16(0, true);
+    const written = view.getUint16(2, true);
+    const skipped = view.getUint16(4, true);
+    const status = view.getUint8(6);
 
-    // Extract name (bytes 1-8)
-    let name = "";
-    for (let i = 1; i <= 8; i++) {
-      if (bytes[i] !== 0 && bytes[i] !== 32) {
-        name += String.fromCharCode(bytes[i]);
-      }
+    if (status === 0) {
+      this.log(`EEPROM saved (${written} bytes written, ${skipped} unchanged)`);
+    } else {
+      this.log(`ERROR: EEPROM verify failed at address ${failAddr}`);
     }
-    name = name.trim() || `PGM${programId + 1}`;
-
-    // Extract loop data (bytes 9-14, cycles removed)
-    const view = new DataView(bytes.buffer, 9);
-    const steps = view.getUint16(0, true);
-    const delayMs = view.getUint32(2, true);
-    // cycles removed - programs run infinitely
-
-    // Store in local storage
-    this.loopPrograms[programId] = { steps, delay: delayMs };
-    this.programNames[programId] = name;
-    this.saveProgramNames();
-
-    // Load into UI
-    document.getElementById("programName").value = name;
-    document.getElementById("loopSteps").value = steps;
-    document.getElementById("loopDelay").value = delayMs;
-    // cycles field removed from UI
-
-    this.log(
-      `Loaded Infinite Loop Program "${name}" from EEPROM (slot ${
-        programId + 1
-      })`
-    );
   }
 
-  handleBulkData(bytes) {
-    this.log("Received bulk EEPROM data");
-
-    let offset = 0;
-
-    // Validate minimum size
-    if (bytes.length < 1) {
-      this.log("ERROR: Bulk data too small");
-      return;
+  handleTraceReport(view) {
+    // Header: nowMs(4), nowUs(4), total(2), count(1);
+    // records: ms(2), event(1), a(1), b(2)
+    const EVENTS = [
+      "",
+      "command",
+      "command done",
+      "move start",
+      "move end",
+      "pause",
+      "resume",
+      "menu enter",
+      "menu exit",
+      "display flush",
+      "eeprom write",
+      "eeprom done",
+      "usb connect",
+      "usb timeout",
+      "cue",
+      "time gap",
+    ];
+    const nowMs = view.getUint32(0, true);
+    const nowUs = view.getUint32(4, true);
+    const total = view.getUint16(8, true);
+    const count = view.getUint8(10);
+
+    // Record times are 16-bit; walk back from the dump time to recover them.
+    // A time gap record holds the 65536ms wraps before it.
+    const TRACE_GAP = 15;
+    const records = [];
+    let time = nowMs;
+    let next = nowMs & 0xffff;
+    let wraps = 0;
+    for (let i = count - 1; i >= 0; i--) {
+      const o = 11 + i * 6;
+      const ms = view.getUint16(o, true);
+      time -= ((next - ms) & 0xffff) + wraps * 65536;
+      next = ms;
+      records[i] = {
+        time,
+        event: view.getUint8(o + 2),
+        a: view.getUint8(o + 3),
+        b: view.getUint16(o + 4, true),
+      };
+      wraps = records[i].event === TRACE_GAP ? records[i].b : 0;
     }
 
-    // Parse program count (first byte)
-    const programCount = bytes[offset];
-    offset += 1;
-
-    this.log(`Loading ${programCount} programs from EEPROM`);
-
-    // Sanity check on program count
-    if (programCount > 10) {
-      this.log(`ERROR: Invalid program count ${programCount}, aborting parse`);
-      return;
+    // With the clock fitted, show host wall-clock times instead
+    const fit = this.clockFit;
+    const hostNow = fit ? this.deviceToHostMs(nowUs) : 0;
+    const stamp = (time) =>
+      fit
+        ? this.formatHostTime(hostNow - ((nowMs - time) * 1000) / fit.rate)
+        : `${(time / 1000).toFixed(3)}s`;
+
+    this.log(`Trace: last ${count} of ${total} events (device time ${nowMs}ms)`);
+    for (const r of records) {
+      const name = EVENTS[r.event] || `event ${r.event}`;
+      this.log(`  ${stamp(r.time)} ${name} a=${r.a} b=${r.b}`);
     }
+  }
 
-    // Clear existing programs
-    this.loopPrograms = {};
-    this.programNames = {};
-
-    // Parse each program (only loop programs)
-    for (let i = 0; i < programCount; i++) {
-      // Check if we have enough bytes left
-      if (offset + 10 > bytes.length) {
-        this.log(`ERROR: Not enough data for program ${i}, stopping parse`);
-        break;
-      }
-
-      const programId = bytes[offset];
-      const programType = bytes[offset + 1];
-
-      // Extract name (bytes offset+2 to offset+9)
-      let name = "";
-      for (let j = 0; j < 8; j++) {
-        const charCode = bytes[offset + 2 + j];
-        if (charCode !== 0 && charCode !== 32) {
-          name += String.fromCharCode(charCode);
-        }
-      }
-      name = name.trim() || `PGM${programId + 1}`;
-
-      this.programNames[programId] = name;
-
-      offset += 10; // programId(1) + type(1) + name(8)
-
-      if (programType === 0) {
-        // Loop program - need 6 more bytes (removed cycles)
-        if (offset + 6 > bytes.length) {
-          this.log(`ERROR: Not enough data for loop program ${programId}`);
-          break;
-        }
+  handleSelfTestReport(view) {
+    // Header: version(1), flags(1), cpuMhz(1), microstepping(1), count(1)
+    const flags = view.getUint8(1);
+    const cpuMhz = view.getUint8(2);
+    const microstepping = view.getUint8(3);
+    const count = view.getUint8(4);
 
-        const loopView = new DataView(bytes.buffer, offset);
-        const steps = loopView.getUint16(0, true);
-        const delayMs = loopView.getUint32(2, true);
-        // cycles removed - programs run infinitely
+    this.log(
+      `Self-test (${flags & 1 ? "dry run" : "live"}, ${cpuMhz} MHz, 1/${microstepping} step):`
+    );
 
-        this.loopPrograms[programId] = { steps, delay: delayMs };
-        offset += 6; // steps(2) + delayMs(4)
+    // Entries: periodUs(4), achievedUs(4), steps(4), headroom(2),
+    // minSlackUs(2), maxLateUs(2), missed(2)
+    let safeHz = 0;
+    for (let i = 0; i < count; i++) {
+      const o = 5 + i * 20;
+      const periodUs = view.getUint32(o, true);
+      const achievedUs = view.getUint32(o + 4, true);
+      const headroom = view.getUint16(o + 12, true) / 10;
+      const maxLateUs = view.getUint16(o + 16, true);
+      const missed = view.getUint16(o + 18, true);
+
+      const requestedHz = Math.round(1e6 / periodUs);
+      const achievedHz = achievedUs ? Math.round(1e6 / achievedUs) : 0;
+      this.log(
+        `  ${requestedHz} Hz -> ${achievedHz} Hz, headroom ${headroom}%, ` +
+          `worst late ${maxLateUs}us, missed ${missed}`
+      );
 
-        this.log(
-          `Loaded Infinite Loop Program "${name}" (slot ${programId + 1})`
-        );
-      } else {
-        this.log(
-          `WARNING: Skipping unsupported program type ${programType} for "${name}"`
-        );
-        // For unknown program types, we can't safely skip them as we don't know the size
-        this.log("ERROR: Cannot continue parsing due to unknown program type");
-        break;
+      // Safe while the achieved rate holds and no pulse slipped a full period
+      if (missed === 0 && achievedHz >= requestedHz * 0.98) {
+        safeHz = requestedHz;
       }
     }
 
-    // Save to localStorage
-    this.saveProgramNames();
-    localStorage.setItem(
-      "sliderLoopPrograms",
-      JSON.stringify(this.loopPrograms)
+    const fullStepHz = safeHz / microstepping;
+    this.log(
+      `Safe max: ${safeHz} microsteps/s (${fullStepHz} steps/s, ` +
+        `${fullStepHz ? Math.ceil(1000 / fullStepHz / 2) : "-"}ms per step)`
     );
-
-    this.log("Bulk EEPROM loading complete");
   }
 
-  async sendCommand(command, binaryData = null) {
+  async sendCommand(command, binaryData = null, quiet = false) {
     if (!this.connected || !this.port) {
       this.log("Not connected to slider");
       return false;
@@ -498,17 +617,19 @@ class SliderController {
     try {
       let data;
 
-      if (binaryData) {
-        // Binary command: command code + binary data
-        const buffer = new Uint8Array(1 + binaryData.length);
-        buffer[0] = command;
-        buffer.set(binaryData, 1);
-        data = buffer;
-        this.log(`Sent binary: CMD=${command}, ${binaryData.length} bytes`);
-      } else if (typeof command === "number") {
-        // Simple command without data
-        data = new Uint8Array([command]);
-        this.log(`Sent: CMD=${command}`);
+      if (typeof command === "number") {
+        // Binary command: code + payload padded to its fixed length, so the
+        // device can split back-to-back commands in one transfer
+        data = new Uint8Array(1 + (this.PAYLOAD_LENGTHS[command] || 0));
+        data[0] = command;
+        if (binaryData) {
+          data.set(binaryData.subarray(0, data.length - 1), 1);
+          if (!quiet) {
+            this.log(`Sent binary: CMD=${command}, ${binaryData.length} bytes`);
+          }
+        } else {
+          this.log(`Sent: CMD=${command}`);
+        }
       } else {
         // Legacy string command
         const encoder = new TextEncoder();
@@ -563,6 +684,557 @@ class SliderController {
     this.log(`Moving to position ${position} at ${speed}ms per step`);
   }
 
+  sendJogSetpoint() {
+    const percent = parseInt(document.getElementById("jogSlider").value) || 0;
+    const maxSpeed = parseInt(document.getElementById("jogMaxSpeed").value) || 0;
+    const accel = parseInt(document.getElementById("jogAccel").value) || 0;
+
+    // Binary format: velocity(2, signed microsteps/s), accel(2, microsteps/s^2)
+    const buffer = new ArrayBuffer(4);
+    const view = new DataView(buffer);
+    const velocity = Math.round((percent / 100) * maxSpeed * this.MICROSTEPPING);
+    view.setInt16(0, Math.max(-32767, Math.min(32767, velocity)), true);
+    view.setUint16(2, Math.min(65535, accel * this.MICROSTEPPING), true);
+
+    this.sendCommand(this.CMD_JOG, new Uint8Array(buffer), true);
+  }
+
+  startJog() {
+    if (this.jogTimer) return;
+    // Stream setpoints while held; the firmware slews between them
+    this.jogTimer = setInterval(() => this.sendJogSetpoint(), this.JOG_STREAM_MS);
+    this.log("Jog started");
+  }
+
+  stopJog() {
+    if (!this.jogTimer) return;
+    clearInterval(this.jogTimer);
+    this.jogTimer = null;
+    document.getElementById("jogSlider").value = 0;
+    this.sendJogSetpoint(); // Ramp down now instead of waiting for the deadman
+    this.log("Jog stopped");
+  }
+
+  saveHomingSettings() {
+    const value = (id) => parseInt(document.getElementById(id).value) || 0;
+    const micro = (steps) => Math.min(65535, steps * this.MICROSTEPPING);
+
+    // Binary format: sub(1), seek(2), latch(2), accel(2), backoff(2), flags(1)
+    // Velocities in microsteps/s, accel in microsteps/s^2, backoff in microsteps
+    const buffer = new ArrayBuffer(10);
+    const view = new DataView(buffer);
+    view.setUint8(0, this.HOMING_CONFIGURE);
+    view.setUint16(1, micro(value("homingSeekSpeed")), true);
+    view.setUint16(3, micro(value("homingLatchSpeed")), true);
+    view.setUint16(5, micro(value("homingAccel")), true);
+    view.setUint16(7, micro(value("homingBackoff")), true);
+    view.setUint8(9, document.getElementById("homingPositive").checked ? 1 : 0);
+
+    this.sendCommand(this.CMD_HOMING, new Uint8Array(buffer));
+  }
+
+  handleHomingReport(view) {
+    // status(1), flags(1), offset(4), durationMs(4),
+    // seek(2), latch(2), accel(2), backoff(2), flags(1), magic(1)
+    const status = view.getUint8(0);
+    const first = view.getUint8(1) & 1;
+    const offset = view.getInt32(2, true);
+    const durationMs = view.getUint32(6, true);
+    const steps = (o) => Math.round(view.getUint16(o, true) / this.MICROSTEPPING);
+
+    document.getElementById("homingSeekSpeed").value = steps(10);
+    document.getElementById("homingLatchSpeed").value = steps(12);
+    document.getElementById("homingAccel").value = steps(14);
+    document.getElementById("homingBackoff").value = steps(16);
+    document.getElementById("homingPositive").checked = view.getUint8(18) & 1;
+
+    const failures = {
+      1: "switch not found",
+      2: "switch still closed after backing off",
+      3: "aborted by stop or pause",
+    };
+    if (status === 4) {
+      this.log("Homing settings loaded");
+    } else if (status !== 0) {
+      this.log(`ERROR: Homing failed: ${failures[status] || status}`);
+    } else if (first) {
+      this.log(`Homed in ${durationMs}ms (first homing since power-up)`);
+    } else {
+      this.log(
+        `Homed in ${durationMs}ms, ${offset} microsteps ` +
+          `(${(offset / this.MICROSTEPPING).toFixed(3)} steps) from the previous zero`
+      );
+    }
+  }
+
+  toggleRecording() {
+    const button = document.getElementById("recordBtn");
+    if (this.recording) {
+      this.sendCommand(this.CMD_RECORD, new Uint8Array([this.RECORD_STOP]));
+      return;
+    }
+    // Sample at the jog setpoint rate
+    this.sendCommand(
+      this.CMD_RECORD,
+      new Uint8Array([this.RECORD_START, this.JOG_STREAM_MS])
+    );
+    this.recording = true;
+    button.textContent = "Stop Recording";
+  }
+
+  playRecording() {
+    const speed = parseInt(document.getElementById("playbackSpeed").value) || 100;
+
+    // Binary format: sub(1), timeScale(2, percent of recorded duration)
+    const buffer = new ArrayBuffer(3);
+    const view = new DataView(buffer);
+    view.setUint8(0, this.RECORD_PLAY);
+    view.setUint16(1, Math.max(10, Math.min(1000, Math.round(10000 / speed))), true);
+
+    this.sendCommand(this.CMD_RECORD, new Uint8Array(buffer));
+    this.log(`Playing recording at ${speed}% speed`);
+  }
+
+  handleRecordingReport(view) {
+    // status(1), tickMs(1), length(2), ticks(4), capacity(2)
+    const status = view.getUint8(0);
+    const tickMs = view.getUint8(1);
+    const length = view.getUint16(2, true);
+    const ticks = view.getUint32(4, true);
+    const capacity = view.getUint16(8, true);
+    const seconds = ((ticks * tickMs) / 1000).toFixed(1);
+
+    if (status === 3) {
+      this.log(`Recording (${capacity} bytes available)`);
+      return;
+    }
+    this.recording = false;
+    document.getElementById("recordBtn").textContent = "Record";
+
+    if (status === 2) {
+      this.log("No recording stored");
+    } else {
+      this.log(
+        `${status === 1 ? "Recording storage full; saved" : "Recording saved"}: ` +
+          `${seconds}s in ${length}/${capacity} bytes`
+      );
+    }
+  }
+
+  runPath() {
+    if (this.pathRunning) {
+      this.log("A path is already running; stop it first");
+      return;
+    }
+
+    // "position:ms, ..." in steps; each point is reached ms after the previous
+    const points = document
+      .getElementById("pathPoints")
+      .value.split(",")
+      .map((entry) => entry.split(":").map((x) => parseInt(x)));
+    if (
+      points.length < 2 ||
+      points.some(([p, ms]) => isNaN(p) || !(ms >= 1 && ms <= 65535))
+    ) {
+      this.log("Error: Enter at least two position:ms points (1-65535ms each)");
+      return;
+    }
+
+    // The carriage moves to the first point and comes to rest at the last;
+    // in between, each point's velocity is the slope through its neighbours
+    const times = [];
+    points.reduce((t, [, ms]) => (times.push(t + ms), t + ms), 0);
+    const knots = points.map(([position, ms], i) => {
+      let velocity = 0;
+      if (i > 0 && i < points.length - 1) {
+        const steps = points[i + 1][0] - points[i - 1][0];
+        velocity = (steps * this.MICROSTEPPING * 1000) / (times[i + 1] - times[i - 1]);
+      }
+      return {
+        position: position * this.MICROSTEPPING,
+        velocity: Math.max(-32767, Math.min(32767, Math.round(velocity))),
+        durationMs: ms,
+      };
+    });
+
+    // Drop knots left from an unstarted path, prime the buffer, then start;
+    // the firmware asks for more with a low-water report
+    this.sendCommand(this.CMD_PVT, new Uint8Array([this.PVT_STOP]), true);
+    this.pathPending = knots;
+    this.pathRunning = true;
+    this.feedPath(this.PVT_BUFFER_SIZE);
+    this.sendCommand(this.CMD_PVT, new Uint8Array([this.PVT_START]), true);
+    this.log(`Running path: ${knots.length} points, ${times[times.length - 1]}ms`);
+  }
+
+  feedPath(space) {
+    while (space > 0 && this.pathPending.length) {
+      const batch = this.pathPending.splice(
+        0,
+        Math.min(space, this.PVT_KNOTS_PER_COMMAND)
+      );
+
+      // Binary format: sub(1), count(1),
+      // count x position(4, microsteps), velocity(2, microsteps/s), durationMs(2)
+      const buffer = new ArrayBuffer(2 + batch.length * 8);
+      const view = new DataView(buffer);
+      view.setUint8(0, this.PVT_APPEND);
+      view.setUint8(1, batch.length);
+      batch.forEach((knot, i) => {
+        view.setInt32(2 + i * 8, knot.position, true);
+        view.setInt16(6 + i * 8, knot.velocity, true);
+        view.setUint16(8 + i * 8, knot.durationMs, true);
+      });
+
+      this.sendCommand(this.CMD_PVT, new Uint8Array(buffer), true);
+      this.pathLastBatch = batch;
+      space -= batch.length;
+    }
+  }
+
+  handlePathReport(view) {
+    // status(1), buffered(1), free(1), dropped(1), consumed(2), position(4)
+    const status = view.getUint8(0);
+    const free = view.getUint8(2);
+    const dropped = view.getUint8(3);
+    const position = view.getInt32(6, true) / this.MICROSTEPPING;
+
+    if (status === 2) {
+      this.feedPath(free);
+    } else if (status === 5) {
+      // Send the knots that did not fit with the next low-water refill
+      this.pathPending.unshift(...this.pathLastBatch.slice(-dropped));
+    } else if (status >= 3 && status !== 5) {
+      this.pathPending = [];
+      this.pathRunning = false;
+      if (status === 3) {
+        this.log(`Path finished at position ${position}`);
+      } else if (status === 4) {
+        this.log(`WARNING: Path ran out of points while moving; stopped at ${position}`);
+      } else {
+        this.log(`Path stopped at position ${position}`);
+      }
+    }
+  }
+
+  setSyncLineMode() {
+    const mode = parseInt(document.getElementById("syncMode").value) || 0;
+    const phaseLock = document.getElementById("syncPhaseLock").checked ? 1 : 0;
+
+    // Binary format: sub(1), mode(1), flags(1)
+    this.sendCommand(
+      this.CMD_SYNC_LINE,
+      new Uint8Array([this.SYNC_LINE_SET_MODE, mode, phaseLock])
+    );
+  }
+
+  armSyncedMove() {
+    const position = parseInt(document.getElementById("targetPosition").value);
+    const speed = parseInt(document.getElementById("manualSpeed").value);
+    if (isNaN(position) || isNaN(speed) || speed < 1) {
+      this.log("Error: Set a target position and speed first");
+      return;
+    }
+
+    // Binary format: sub(1), position(2), speed(4)
+    const buffer = new ArrayBuffer(7);
+    const view = new DataView(buffer);
+    view.setUint8(0, this.SYNC_LINE_ARM_MOVE);
+    view.setUint16(1, position, true);
+    view.setUint32(3, speed, true);
+    this.sendCommand(this.CMD_SYNC_LINE, new Uint8Array(buffer));
+  }
+
+  armSyncedProgram() {
+    const slot = parseInt(document.getElementById("programSlot").value) || 0;
+
+    // Binary format: sub(1), programId(1)
+    this.sendCommand(
+      this.CMD_SYNC_LINE,
+      new Uint8Array([this.SYNC_LINE_ARM_RUN, slot])
+    );
+  }
+
+  handleSyncLineReport(view) {
+    // mode(1), flags(1), state(1), ticks(2), lastErrorUs(2), maxErrorUs(2)
+    const MODES = ["off", "master", "follower"];
+    const STATES = ["idle", "armed", "running"];
+    const mode = view.getUint8(0);
+    const state = view.getUint8(2);
+    const ticks = view.getUint16(3, true);
+    const lastErrorUs = view.getInt16(5, true);
+    const maxErrorUs = view.getUint16(7, true);
+
+    document.getElementById("syncMode").value = mode;
+    document.getElementById("syncPhaseLock").checked = view.getUint8(1) & 1;
+
+    let message = `Sync line ${MODES[mode] || mode}, ${STATES[state] || state}`;
+    if (state === 0 && ticks > 0) {
+      message += `; last run ${ticks} ticks`;
+      if (mode === 2) {
+        message += `, tick error ${lastErrorUs}us (worst ${maxErrorUs}us)`;
+      }
+    }
+    this.log(message);
+  }
+
+  saveDriverSettings() {
+    const value = (id) => parseInt(document.getElementById(id).value) || 0;
+    const current = (id) => Math.min(31, Math.max(0, value(id)));
+
+    // Binary format: sub(1), run(1), hold(1), stealthMaxVelocity(2), flags(1)
+    // Velocity in microsteps/s
+    const buffer = new ArrayBuffer(6);
+    const view = new DataView(buffer);
+    view.setUint8(0, this.DRIVER_CONFIGURE);
+    view.setUint8(1, current("driverRunCurrent"));
+    view.setUint8(2, current("driverHoldCurrent"));
+    view.setUint16(
+      3,
+      Math.min(65535, value("driverStealthSpeed") * this.MICROSTEPPING),
+      true
+    );
+    view.setUint8(
+      5,
+      document.getElementById("driverSpreadCycle").checked ? 1 : 0
+    );
+
+    this.sendCommand(this.CMD_DRIVER, new Uint8Array(buffer));
+  }
+
+  handleDriverReport(view) {
+    // status(1), current(1), stallGuard(2), errors(2),
+    // run(1), hold(1), stealthMaxVelocity(2), flags(1), magic(1)
+    const status = view.getUint8(0);
+    const current = view.getUint8(1);
+    const stallGuard = view.getUint16(2, true);
+    const errors = view.getUint16(4, true);
+
+    document.getElementById("driverRunCurrent").value = view.getUint8(6);
+    document.getElementById("driverHoldCurrent").value = view.getUint8(7);
+    document.getElementById("driverStealthSpeed").value = Math.round(
+      view.getUint16(8, true) / this.MICROSTEPPING
+    );
+    document.getElementById("driverSpreadCycle").checked = view.getUint8(10) & 1;
+
+    const FAULTS = [
+      [0x08, "over 120C"],
+      [0x10, "overtemperature shutdown"],
+      [0x20, "short circuit"],
+      [0x40, "open load"],
+    ];
+    const faults = FAULTS.filter(([bit]) => status & bit).map(([, name]) => name);
+    let message = status & 0x01 ? "Driver online" : "Driver not responding";
+    if (status & 0x80) {
+      message += " (simulated)";
+    }
+    if (status & 0x01) {
+      message +=
+        `, ${status & 0x02 ? "silent" : "full-torque"} mode, ` +
+        `current ${current}/31${status & 0x04 ? " (standstill)" : ""}, ` +
+        `StallGuard ${stallGuard}`;
+    }
+    if (faults.length > 0) {
+      message += `; FAULT: ${faults.join(", ")}`;
+    }
+    if (errors > 0) {
+      message += `; ${errors} link errors`;
+    }
+
+    document.getElementById("driverStatus").textContent = message;
+    this.log(faults.length > 0 ? `ERROR: ${message}` : message);
+  }
+
+  resetClock() {
+    this.clockToken = 0;
+    this.clockPending = new Map(); // token -> host send time (ms)
+    this.clockSamples = [];
+    this.clockFit = null; // Device micros() = deviceUs + (host ms - hostMs) * rate
+  }
+
+  sendClockSync() {
+    if (!this.connected) return;
+    // Binary format: token(4), echoed back with the device timestamps
+    const token = (this.clockToken = (this.clockToken + 1) >>> 0);
+    this.clockPending.delete(token - this.CLOCK_SAMPLES); // Never answered
+    const buffer = new ArrayBuffer(4);
+    new DataView(buffer).setUint32(0, token, true);
+    this.clockPending.set(token, performance.now());
+    this.sendCommand(this.CMD_CLOCK_SYNC, new Uint8Array(buffer), true);
+  }
+
+  // The device micros() value nearest to a reference on the unwrapped
+  // timeline; micros() wraps every 71 minutes
+  unwrapDeviceUs(us, referenceUs) {
+    const WRAP = 4294967296;
+    const delta = ((((us - referenceUs) % WRAP) + WRAP * 1.5) % WRAP) - WRAP / 2;
+    return referenceUs + delta;
+  }
+
+  handleClockReport(view) {
+    // token(4), receivedUs(4), sentUs(4)
+    const receivedAt = performance.now();
+    const token = view.getUint32(0, true);
+    const sentAt = this.clockPending.get(token);
+    if (sentAt === undefined) return;
+    this.clockPending.delete(token);
+
+    const receivedUs = view.getUint32(4, true);
+    const turnaroundUs = (view.getUint32(8, true) - receivedUs) >>> 0;
+    const last = this.clockSamples[this.clockSamples.length - 1];
+    const midUs = receivedUs + turnaroundUs / 2;
+    this.clockSamples.push({
+      hostMs: (sentAt + receivedAt) / 2,
+      deviceUs: last ? this.unwrapDeviceUs(midUs, last.deviceUs) : midUs,
+      roundTripMs: receivedAt - sentAt - turnaroundUs / 1000,
+    });
+    if (this.clockSamples.length > this.CLOCK_SAMPLES) {
+      this.clockSamples.shift();
+    }
+    this.fitClock();
+  }
+
+  fitClock() {
+    // USB and loop() delays only ever add time, and add it unevenly to the
+    // two directions; the quickest exchanges are the most symmetric, so the
+    // line is fitted through the faster half only
+    const best = [...this.clockSamples]
+      .sort((a, b) => a.roundTripMs - b.roundTripMs)
+      .slice(0, Math.ceil(this.clockSamples.length / 2));
+    const mean = (key) => best.reduce((sum, s) => sum + s[key], 0) / best.length;
+    const hostMs = mean("hostMs");
+    const deviceUs = mean("deviceUs");
+
+    // Drift: slope of device time against host time, once the history is
+    // long enough for round-trip noise not to dominate it
+    const times = best.map((s) => s.hostMs);
+    let rate = 1000;
+    if (Math.max(...times) - Math.min(...times) >= this.CLOCK_MIN_SPAN_MS) {
+      let sxy = 0;
+      let sxx = 0;
+      for (const s of best) {
+        sxy += (s.hostMs - hostMs) * (s.deviceUs - deviceUs);
+        sxx += (s.hostMs - hostMs) ** 2;
+      }
+      rate = sxy / sxx;
+    }
+
+    this.clockFit = { hostMs, deviceUs, rate };
+    const uncertaintyMs = best[0].roundTripMs / 2;
+    const ppm = Math.round((rate / 1000 - 1) * 1e6);
+    document.getElementById("clockStatus").textContent =
+      `Clock synchronized to ±${uncertaintyMs.toFixed(1)}ms, ` +
+      `device drift ${ppm >= 0 ? "+" : ""}${ppm} ppm`;
+  }
+
+  hostToDeviceUs(hostMs) {
+    const fit = this.clockFit;
+    return Math.round(fit.deviceUs + (hostMs - fit.hostMs) * fit.rate) >>> 0;
+  }
+
+  deviceToHostMs(us) {
+    const fit = this.clockFit;
+    const nowUs = fit.deviceUs + (performance.now() - fit.hostMs) * fit.rate;
+    return fit.hostMs + (this.unwrapDeviceUs(us, nowUs) - fit.deviceUs) / fit.rate;
+  }
+
+  formatHostTime(hostMs) {
+    const time = new Date(performance.timeOrigin + hostMs);
+    const ms = String(time.getMilliseconds()).padStart(3, "0");
+    return `${time.toTimeString().slice(0, 8)}.${ms}`;
+  }
+
+  // Run a command at a host time (performance.now() ms). Commands with a
+  // payload over SCHEDULE_PAYLOAD bytes cannot be scheduled.
+  scheduleCommand(hostMs, command, payload = new Uint8Array(0)) {
+    if (!this.clockFit) {
+      this.log("Error: Device clock not synchronized yet");
+      return false;
+    }
+    if (
+      (this.PAYLOAD_LENGTHS[command] || 0) > this.SCHEDULE_PAYLOAD ||
+      command === this.CMD_SCHEDULE
+    ) {
+      this.log(`Error: Command ${command} cannot be scheduled`);
+      return false;
+    }
+    // micros() wraps every 71 minutes; further ahead would read as past
+    if (hostMs - performance.now() > this.SCHEDULE_HORIZON_MS) {
+      this.log("Error: Cues can be set at most 30 minutes ahead");
+      return false;
+    }
+
+    // Binary format: sub(1), id(1), atUs(4), command(1), payload(10)
+    const buffer = new ArrayBuffer(7 + this.SCHEDULE_PAYLOAD);
+    const view = new DataView(buffer);
+    this.nextCue = (this.nextCue % 255) + 1; // 0 means none in reports
+    view.setUint8(0, this.SCHEDULE_ADD);
+    view.setUint8(1, this.nextCue);
+    view.setUint32(2, this.hostToDeviceUs(hostMs), true);
+    view.setUint8(6, command);
+    new Uint8Array(buffer).set(payload, 7);
+
+    return this.sendCommand(this.CMD_SCHEDULE, new Uint8Array(buffer), true);
+  }
+
+  cueTime() {
+    const seconds = parseFloat(document.getElementById("cueDelay").value);
+    return performance.now() + Math.max(0.1, seconds || 0) * 1000;
+  }
+
+  cueMove() {
+    const position = parseInt(document.getElementById("targetPosition").value);
+    const speed = parseInt(document.getElementById("manualSpeed").value);
+    if (isNaN(position) || isNaN(speed) || speed < 1) {
+      this.log("Error: Set a target position and speed first");
+      return;
+    }
+
+    // Binary format: position(2), speed(4)
+    const buffer = new ArrayBuffer(6);
+    const view = new DataView(buffer);
+    view.setUint16(0, position, true);
+    view.setUint32(2, speed, true);
+    this.scheduleCommand(
+      this.cueTime(),
+      this.CMD_POS_WITH_SPEED,
+      new Uint8Array(buffer)
+    );
+  }
+
+  cueProgram() {
+    const slot = parseInt(document.getElementById("programSlot").value) || 0;
+    this.scheduleCommand(this.cueTime(), this.CMD_RUN, new Uint8Array([slot]));
+  }
+
+  handleScheduleReport(view) {
+    // status(1), id(1), waiting(1), atUs(4), firedUs(4)
+    const status = view.getUint8(0);
+    const id = view.getUint8(1);
+    const waiting = view.getUint8(2);
+    const atUs = view.getUint32(3, true);
+    const firedUs = view.getUint32(7, true);
+    const at = (us) =>
+      this.clockFit ? this.formatHostTime(this.deviceToHostMs(us)) : `${us}us`;
+
+    if (status === 0 && id === 0) {
+      this.log("No cues waiting");
+    } else if (status === 0) {
+      this.log(`Cue ${id} set for ${at(atUs)} (${waiting} waiting)`);
+    } else if (status === 1) {
+      const lateMs = ((firedUs - atUs) >>> 0) / 1000;
+      this.log(`Cue ${id} started at ${at(firedUs)}, ${lateMs.toFixed(1)}ms late`);
+    } else if (status === 2) {
+      this.log(`ERROR: Cue ${id} not set: ${waiting} cues already waiting`);
+    } else if (status === 3) {
+      this.log(`ERROR: Cue ${id} not set: more than 30 minutes ahead`);
+    } else if (status === 5) {
+      this.log(`ERROR: Cue ${id} not set: command cannot be scheduled`);
+    } else {
+      this.log("Cues cancelled");
+    }
+  }
+
   handleHome() {
     const speed = parseInt(document.getElementById("manualSpeed").value);
 
@@ -585,6 +1257,19 @@ class SliderController {
     this.log(`Going home (position 0) at ${speed}ms per step`);
   }
 
+  runSelfTest() {
+    const dryRun = document.getElementById("selfTestDryRun").checked;
+
+    // Binary format: flags(1), msPerRate(2)
+    const buffer = new ArrayBuffer(3);
+    const view = new DataView(buffer);
+    view.setUint8(0, dryRun ? 1 : 0);
+    view.setUint16(1, 250, true);
+
+    this.sendCommand(this.CMD_SELF_TEST, new Uint8Array(buffer));
+    this.log(`Running self-test (${dryRun ? "STEP output gated" : "live"})`);
+  }
+
   saveProgram() {
     const programSlot = document.getElementById("programSlot").value;
     const programName =
@@ -639,6 +1324,170 @@ class SliderController {
     );
   }
 
+  // Canonical program bytes, hashed on both sides: name(8), steps(2), delayMs(4)
+  encodeProgram(name, steps, delayMs) {
+    const bytes = new Uint8Array(14);
+    const view = new DataView(bytes.buffer);
+    const nameBytes = new TextEncoder().encode(
+      name.substring(0, 8).toUpperCase().padEnd(8, " ")
+    );
+    for (let i = 0; i < 8; i++) {
+      bytes[i] = nameBytes[i] || 32; // 32 = space
+    }
+    view.setUint16(8, steps, true);
+    view.setUint32(10, delayMs, true);
+    return bytes;
+  }
+
+  // CRC-16/CCITT-FALSE, matching programHash() in the firmware
+  crc16(bytes) {
+    let crc = 0xffff;
+    for (const byte of bytes) {
+      crc ^= byte << 8;
+      for (let bit = 0; bit < 8; bit++) {
+        crc = crc & 0x8000 ? ((crc << 1) ^ 0x1021) & 0xffff : (crc << 1) & 0xffff;
+      }
+    }
+    return crc;
+  }
+
+  syncLibrary() {
+    // Manifest: sub(1), mask(1), hash(2) x MAX_PROGRAMS
+    const manifest = new Uint8Array(2 + this.MAX_PROGRAMS * 2);
+    const view = new DataView(manifest.buffer);
+    const records = {};
+    let mask = 0;
+
+    for (let id = 0; id < this.MAX_PROGRAMS; id++) {
+      const program = this.loopPrograms[id];
+      if (!program) continue;
+      const name = this.programNames[id] || `PGM${id + 1}`;
+      records[id] = this.encodeProgram(name, program.steps, program.delay);
+      view.setUint16(2 + id * 2, this.crc16(records[id]), true);
+      mask |= 1 << id;
+    }
+    manifest[0] = this.SYNC_MANIFEST;
+    manifest[1] = mask;
+
+    this.pendingSync = records;
+    this.sendCommand(this.CMD_PROGRAM_SYNC, manifest);
+    this.log(`Syncing ${Object.keys(records).length} programs`);
+  }
+
+  async handleSyncReport(view) {
+    // phase(1), status(1), mask(1)
+    const phase = view.getUint8(0);
+    const status = view.getUint8(1);
+    const mask = view.getUint8(2);
+
+    if (phase === 0) {
+      const records = this.pendingSync || {};
+      this.pendingSync = null;
+
+      // Transfer only the slots whose hash differs, then commit them together
+      for (let id = 0; id < this.MAX_PROGRAMS; id++) {
+        if (!(mask & (1 << id)) || !records[id]) continue;
+        const slot = new Uint8Array(2 + records[id].length);
+        slot[0] = this.SYNC_SLOT;
+        slot[1] = id;
+        slot.set(records[id], 2);
+        this.sendCommand(this.CMD_PROGRAM_SYNC, slot);
+      }
+      // Queued behind the slots; all of them go out in one transfer
+      await this.sendCommand(
+        this.CMD_PROGRAM_SYNC,
+        new Uint8Array([this.SYNC_COMMIT, mask])
+      );
+      return;
+    }
+
+    if (status === 0) {
+      const count = [...Array(this.MAX_PROGRAMS).keys()].filter(
+        (id) => mask & (1 << id)
+      ).length;
+      this.log(
+        count
+          ? `Program sync committed (${count} changed)`
+          : "Program sync: device already up to date"
+      );
+    } else {
+      const reasons = {
+        1: "no transaction open",
+        2: "not every slot arrived",
+        3: "bad slot",
+        4: "EEPROM write failed",
+      };
+      this.log(
+        `ERROR: Program sync failed (${reasons[status] || status}), ` +
+          "nothing changed"
+      );
+    }
+  }
+
+  savePlaylist() {
+    const slot = parseInt(document.getElementById("playlistSlot").value);
+    const name = (
+      document.getElementById("playlistName").value.trim() || `LIST${slot + 1}`
+    )
+      .substring(0, 8)
+      .toUpperCase();
+    const loop = document.getElementById("playlistLoop").checked;
+
+    // Entries: "<program>x<cycles>[+<dwellMs>]", comma separated
+    const entries = [];
+    const text = document.getElementById("playlistEntries").value;
+    for (const part of text.split(",")) {
+      if (!part.trim()) continue;
+      const match = part.trim().match(/^(\d+)\s*x\s*(\d+)(?:\s*\+\s*(\d+))?$/i);
+      if (!match) {
+        this.log(`Error: Invalid playlist entry "${part.trim()}"`);
+        return;
+      }
+      entries.push({
+        programId: parseInt(match[1]) - 1,
+        repeats: Math.min(parseInt(match[2]), 255),
+        dwellMs: Math.min(parseInt(match[3] || "0"), 65535),
+      });
+    }
+    if (entries.length === 0 || entries.length > this.MAX_PLAYLIST_ENTRIES) {
+      this.log(`Error: A playlist needs 1-${this.MAX_PLAYLIST_ENTRIES} entries`);
+      return;
+    }
+
+    // Binary format: playlistId(1), name(8), flags(1), count(1),
+    // entries(6 x programId(1), repeats(1), dwellMs(2))
+    const buffer = new ArrayBuffer(11 + this.MAX_PLAYLIST_ENTRIES * 4);
+    const view = new DataView(buffer);
+    const nameBytes = new TextEncoder().encode(name.padEnd(8, " "));
+    view.setUint8(0, slot);
+    for (let i = 0; i < 8; i++) {
+      view.setUint8(1 + i, nameBytes[i] || 32);
+    }
+    view.setUint8(9, loop ? 1 : 0);
+    view.setUint8(10, entries.length);
+    entries.forEach((entry, i) => {
+      view.setUint8(11 + i * 4, entry.programId);
+      view.setUint8(12 + i * 4, entry.repeats);
+      view.setUint16(13 + i * 4, entry.dwellMs, true);
+    });
+
+    this.sendCommand(this.CMD_PLAYLIST, new Uint8Array(buffer));
+    this.log(
+      `Playlist "${name}" saved to slot ${slot + 1} (${entries.length} entries${
+        loop ? ", looping" : ""
+      })`
+    );
+  }
+
+  runPlaylist() {
+    const slot = parseInt(document.getElementById("playlistSlot").value);
+    this.sendCommand(
+      this.CMD_RUN,
+      new Uint8Array([slot | this.RUN_PLAYLIST_FLAG])
+    );
+    this.log(`Running Playlist ${slot + 1}`);
+  }
+
   testProgram() {
     const programSlot = parseInt(document.getElementById("programSlot").value);
 
@@ -3,6 +3,59 @@ var serial = {};
 (function () {
   "use strict";
 
+  // Reads are kept queued so the IN endpoint never idles between
+  // completions; each returns early on a short packet
+  serial.READ_SIZE = 4096;
+  serial.READS_IN_FLIGHT = 4;
+
+  serial.REPORT_MAGIC = 0xa5;
+  const textDecoder = new TextDecoder();
+
+  // Streaming decoder for the device output: binary report frames
+  // ([0xA5][type][length][payload]) and "\n"-terminated text lines, in any
+  // order and split anywhere across transfers. Frames are handed out as
+  // DataViews over the received buffer, valid only during the callback.
+  serial.FrameDecoder = function (onFrame, onLine) {
+    this.onFrame = onFrame;
+    this.onLine = onLine;
+    this.partial_ = null; // Unconsumed tail of the previous transfer
+  };
+
+  serial.FrameDecoder.prototype.push = function (view) {
+    let bytes = new Uint8Array(view.buffer, view.byteOffset, view.byteLength);
+    if (this.partial_) {
+      const joined = new Uint8Array(this.partial_.length + bytes.length);
+      joined.set(this.partial_);
+      joined.set(bytes, this.partial_.length);
+      bytes = joined;
+      this.partial_ = null;
+    }
+
+    let offset = 0;
+    while (offset < bytes.length) {
+      if (bytes[offset] === serial.REPORT_MAGIC) {
+        if (offset + 3 > bytes.length) break;
+        const end = offset + 3 + bytes[offset + 2];
+        if (end > bytes.length) break;
+        this.onFrame(
+          bytes[offset + 1],
+          new DataView(bytes.buffer, bytes.byteOffset + offset + 3, end - offset - 3),
+        );
+        offset = end;
+      } else {
+        const newline = bytes.indexOf(10, offset);
+        if (newline < 0) break;
+        const line = textDecoder.decode(bytes.subarray(offset, newline)).trim();
+        if (line) this.onLine(line);
+        offset = newline + 1;
+      }
+    }
+
+    if (offset < bytes.length) {
+      this.partial_ = bytes.slice(offset);
+    }
+  };
+
   serial.getPorts = function () {
     return navigator.usb.getDevices().then((devices) => {
       return devices.map((device) => new serial.Port(device));
@@ -37,21 +90,29 @@ var serial = {};
     this.interfaceNumber_ = 0; // Start with interface 0, will be detected
     this.endpointIn_ = 0; // Will be detected
     this.endpointOut_ = 0; // Will be detected
+    this.readFailed_ = false;
+    this.outQueue_ = []; // Commands waiting for the next transferOut
+    this.outFlush_ = null; // Pending coalesced transfer
+    this.outBusy_ = Promise.resolve(); // Transfer currently on the wire
   };
 
   serial.Port.prototype.connect = function () {
-    let readLoop = () => {
-      this.device_.transferIn(this.endpointIn_, 64).then(
+    // Transfers on one endpoint complete in submission order, so each
+    // completed read queues the next and the data stays in order
+    let read = () => {
+      this.device_.transferIn(this.endpointIn_, serial.READ_SIZE).then(
         (result) => {
           if (result.data && result.data.byteLength > 0) {
             this.onReceive(result.data);
           }
-          // Add a small delay to reduce USB traffic
-          setTimeout(readLoop, 10);
+          read();
         },
         (error) => {
-          this.onReceiveError(error);
-          // Stop the loop on error to prevent spam
+          // Every queued read fails at once; report it a single time
+          if (!this.readFailed_) {
+            this.readFailed_ = true;
+            this.onReceiveError(error);
+          }
         },
       );
     };
@@ -137,7 +198,10 @@ var serial = {};
         }),
       )
       .then(() => {
-        readLoop();
+        this.readFailed_ = false;
+        for (let i = 0; i < serial.READS_IN_FLIGHT; i++) {
+          read();
+        }
       });
   };
 
@@ -153,7 +217,36 @@ var serial = {};
       .then(() => this.device_.close());
   };
 
+  // Queue data for the OUT endpoint. Everything sent while the previous
+  // transfer is on the wire goes out together in the next transferOut; the
+  // returned promise settles with that transfer.
   serial.Port.prototype.send = function (data) {
-    return this.device_.transferOut(this.endpointOut_, data);
+    this.outQueue_.push(
+      data instanceof ArrayBuffer
+        ? new Uint8Array(data)
+        : new Uint8Array(data.buffer, data.byteOffset, data.byteLength),
+    );
+
+    if (!this.outFlush_) {
+      this.outFlush_ = this.outBusy_.then(() => {
+        const chunks = this.outQueue_;
+        this.outQueue_ = [];
+        this.outFlush_ = null;
+
+        let size = 0;
+        chunks.forEach((chunk) => (size += chunk.length));
+        const out = new Uint8Array(size);
+        let offset = 0;
+        chunks.forEach((chunk) => {
+          out.set(chunk, offset);
+          offset += chunk.length;
+        });
+
+        const transfer = this.device_.transferOut(this.endpointOut_, out);
+        this.outBusy_ = transfer.catch(() => {});
+        return transfer;
+      });
+    }
+    return this.outFlush_;
   };
 })();